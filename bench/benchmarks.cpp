@@ -0,0 +1,933 @@
+/*
+
+Verstable v2.1.1 - bench/benchmarks.cpp
+
+This file times Verstable maps against C++'s unordered_map on a range of operations, key types, value sizes, table
+sizes, and maximum load factors.
+For each combination, it reports the average time per operation in nanoseconds and the peak number of bytes that the
+table had allocated, which it measures via tracking allocation functions (MALLOC_FN and FREE_FN in the case of
+Verstable and an allocator in the case of unordered_map).
+The results are printed to stdout in CSV format so that they can be compared across versions to detect regressions.
+
+Compile with optimizations and run, e.g.:
+
+  g++ -std=c++11 -O3 -DNDEBUG bench/benchmarks.cpp -o benchmarks && ./benchmarks > results.csv
+
+The operations timed are:
+* insert: Inserting each key into an initially empty table (including the cost of growing the table).
+* replace: Inserting each key again, replacing the existing key and value.
+* lookup_hit: Looking up each key, in random order.
+* lookup_miss: Looking up keys that are not in the table.
+* iterate: Iterating over the table (per key).
+* erase: Erasing each key, in random order.
+
+The key and value shapes are:
+* integer: uint64_t keys and uint64_t values.
+* string: char * keys (NULL-terminated, 16 characters long) and uint64_t values.
+* large_value: uint64_t keys and 256-byte values.
+
+Both tables use the same hash function for strings (vt_hash_string), since std::hash for char * hashes the pointer.
+For integers, each table uses its default hash function.
+
+For integer keys at the maximum load factor of 0.9, the benchmark also times a Verstable map that uses the huge-page
+allocator (labeled verstable_huge_pages), so that its effect on lookup_miss and the other operations can be compared
+with the ordinary allocator.
+Without huge pages, random lookups in a table larger than the CPU caches typically incur a TLB miss, as well as a cache
+miss, on every access to the buckets array.
+Whether the operating system actually provides huge pages depends on its configuration (see the huge-page allocator in
+verstable.h).
+
+For string keys at the maximum load factor of 0.9, the benchmark also times a Verstable map whose keys are the same
+strings stored as vt_sso_string (labeled verstable_sso_string), which holds strings of this length inside the bucket so
+that key comparisons do not dereference pointers.
+
+For large values at the maximum load factor of 0.9, the benchmark also times a Verstable map that stores its values
+apart from its keys (labeled verstable_separate_values), so that lookups do not drag values through the CPU cache.
+At the maximum load factor of 0.5, it also times a Verstable map that stores its keys and values in a dense array in
+insertion order (labeled verstable_ordered), so that iteration does not skip empty buckets.
+
+For string keys at the maximum load factor of 0.9, the benchmark also times rehashing a full table to the same
+bucket count (the rehash operation, per key) with and without STORE_HASH (labeled verstable_store_hash), which reuses
+each key's stored hash code rather than calling HASH_FN.
+Besides the 16-character strings (string), it uses 64-character strings (long_string), whose hashing costs more.
+
+After the above, for a Verstable set of integer keys at the maximum load factor of 0.9 holding 1M, 10M, and 100M keys,
+the benchmark times GET_BATCH_LOOKUPS random lookups (half hits and half misses) performed via NAME_get in a loop
+(the get_loop operation) and via NAME_get_batch in batches of GET_BATCH_SIZE keys (the get_batch operation).
+The 100M-key table needs about 1.5 GB of memory.
+
+Finally, the benchmark times iteration (per key) over an integer map with 2^20 buckets at loads of 1%, 5%, 25%, and
+90%, which determine how many empty buckets iteration must skip per key.
+These rows are labeled according to the metadata scan that iteration uses, which depends on the instruction sets
+enabled at compile time (verstable_scan_sse2 or verstable_scan_scalar), so compile with and without -DVT_NO_SIMD to
+compare the scans.
+
+License (MIT):
+
+  Copyright (c) 2023-2024 Jackson L. Allan
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+  documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+  persons to whom the Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+  Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+  OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+
+// Provide the huge-page allocator.
+#define VT_ENABLE_HUGE_PAGES
+
+// Assert macro that is not disabled by NDEBUG.
+#define ALWAYS_ASSERT( xp )                                                                                     \
+( (xp) ? (void)0 : ( std::cerr << "Assertion failed at line " << __LINE__ << ": " << #xp << '\n', exit( 1 ) ) ) \
+
+// Macros to control the number of operations timed per measurement and the number of measurements of which the
+// fastest is reported.
+// For small tables, each measurement spans multiple tables so that it covers roughly OPS_PER_MEASUREMENT operations.
+#define OPS_PER_MEASUREMENT 1000000
+#define N_RUNS 3
+
+// Table sizes (i.e. number of keys) to benchmark.
+static const size_t sizes[] = { 1000, 100000, 1000000 };
+
+// Table sizes, number of lookups, and batch size for the comparison of NAME_get_batch with NAME_get in a loop.
+static const size_t get_batch_sizes[] = { 1000000, 10000000, 100000000 };
+#define GET_BATCH_LOOKUPS 10000000
+#define GET_BATCH_SIZE 4096
+
+// Custom malloc and free functions that track the number of bytes currently allocated and the peak.
+
+size_t current_bytes;
+size_t peak_bytes;
+
+void *tracking_malloc( size_t size )
+{
+  void *ptr = malloc( size );
+  ALWAYS_ASSERT( ptr );
+
+  current_bytes += size;
+  if( current_bytes > peak_bytes )
+    peak_bytes = current_bytes;
+
+  return ptr;
+}
+
+void tracking_free( void *ptr, size_t size )
+{
+  if( ptr )
+    current_bytes -= size;
+
+  free( ptr );
+}
+
+// Allocator that conveys unordered_map's allocations to the above functions.
+template<typename ty> struct tracking_allocator
+{
+  typedef ty value_type;
+
+  tracking_allocator() {}
+  template<typename other_ty> tracking_allocator( const tracking_allocator<other_ty> & ) {}
+
+  ty *allocate( size_t n )
+  {
+    return (ty *)tracking_malloc( n * sizeof( ty ) );
+  }
+
+  void deallocate( ty *ptr, size_t n )
+  {
+    tracking_free( ptr, n * sizeof( ty ) );
+  }
+};
+
+template<typename ty_1, typename ty_2>
+bool operator==( const tracking_allocator<ty_1> &, const tracking_allocator<ty_2> & )
+{
+  return true;
+}
+
+template<typename ty_1, typename ty_2>
+bool operator!=( const tracking_allocator<ty_1> &, const tracking_allocator<ty_2> & )
+{
+  return false;
+}
+
+// Large value type.
+struct large_value
+{
+  uint64_t data[ 32 ];
+};
+
+// Functions that reduce a value to an integer, which is accumulated into a checksum to prevent the compiler from
+// optimizing away lookups and iteration.
+
+inline uint64_t checksum( uint64_t val )
+{
+  return val;
+}
+
+inline uint64_t checksum( const large_value &val )
+{
+  return val.data[ 0 ];
+}
+
+volatile uint64_t sink;
+
+// Instantiate hash table templates.
+
+#define NAME      integer_map_50
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define HASH_FN   vt_hash_integer // C++.
+#define CMPR_FN   vt_cmpr_integer // C++.
+#define MAX_LOAD  0.5
+#define MALLOC_FN tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      integer_map_75
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define HASH_FN   vt_hash_integer
+#define CMPR_FN   vt_cmpr_integer
+#define MAX_LOAD  0.75
+#define MALLOC_FN tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      integer_map_90
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define HASH_FN   vt_hash_integer
+#define CMPR_FN   vt_cmpr_integer
+#define MAX_LOAD  0.9
+#define MALLOC_FN tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+// Wrappers that convey the huge-page allocator's allocations to the same byte counts.
+
+void *tracking_huge_page_malloc( size_t size, vt_huge_page_ctx *ctx )
+{
+  void *ptr = vt_huge_page_malloc( size, ctx );
+  ALWAYS_ASSERT( ptr );
+
+  current_bytes += size;
+  if( current_bytes > peak_bytes )
+    peak_bytes = current_bytes;
+
+  return ptr;
+}
+
+void tracking_huge_page_free( void *ptr, size_t size, vt_huge_page_ctx *ctx )
+{
+  if( ptr )
+    current_bytes -= size;
+
+  vt_huge_page_free( ptr, size, ctx );
+}
+
+#define NAME      integer_set_90
+#define KEY_TY    uint64_t
+#define HASH_FN   vt_hash_integer
+#define CMPR_FN   vt_cmpr_integer
+#define MAX_LOAD  0.9
+#define MALLOC_FN tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      huge_page_integer_map_90
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define HASH_FN   vt_hash_integer
+#define CMPR_FN   vt_cmpr_integer
+#define CTX_TY    vt_huge_page_ctx
+#define MAX_LOAD  0.9
+#define MALLOC_FN tracking_huge_page_malloc
+#define FREE_FN   tracking_huge_page_free
+#define MALLOC_FN_ZEROES
+#include "../verstable.h"
+
+#define NAME      string_map_50
+#define KEY_TY    char *
+#define VAL_TY    uint64_t
+#define HASH_FN   vt_hash_string
+#define CMPR_FN   vt_cmpr_string
+#define MAX_LOAD  0.5
+#define MALLOC_FN tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      string_map_75
+#define KEY_TY    char *
+#define VAL_TY    uint64_t
+#define HASH_FN   vt_hash_string
+#define CMPR_FN   vt_cmpr_string
+#define MAX_LOAD  0.75
+#define MALLOC_FN tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      string_map_90
+#define KEY_TY    char *
+#define VAL_TY    uint64_t
+#define HASH_FN   vt_hash_string
+#define CMPR_FN   vt_cmpr_string
+#define MAX_LOAD  0.9
+#define MALLOC_FN tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      store_hash_string_map_90
+#define KEY_TY    char *
+#define VAL_TY    uint64_t
+#define HASH_FN   vt_hash_string
+#define CMPR_FN   vt_cmpr_string
+#define STORE_HASH
+#define MAX_LOAD  0.9
+#define MALLOC_FN tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      sso_string_map_90
+#define KEY_TY    vt_sso_string
+#define VAL_TY    uint64_t
+#define HASH_FN   vt_hash_sso_string
+#define CMPR_FN   vt_cmpr_sso_string
+#define MAX_LOAD  0.9
+#define MALLOC_FN tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      large_value_map_50
+#define KEY_TY    uint64_t
+#define VAL_TY    large_value
+#define HASH_FN   vt_hash_integer
+#define CMPR_FN   vt_cmpr_integer
+#define MAX_LOAD  0.5
+#define MALLOC_FN tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      large_value_map_75
+#define KEY_TY    uint64_t
+#define VAL_TY    large_value
+#define HASH_FN   vt_hash_integer
+#define CMPR_FN   vt_cmpr_integer
+#define MAX_LOAD  0.75
+#define MALLOC_FN tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      large_value_map_90
+#define KEY_TY    uint64_t
+#define VAL_TY    large_value
+#define HASH_FN   vt_hash_integer
+#define CMPR_FN   vt_cmpr_integer
+#define MAX_LOAD  0.9
+#define MALLOC_FN tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      ordered_large_value_map_50
+#define KEY_TY    uint64_t
+#define VAL_TY    large_value
+#define HASH_FN   vt_hash_integer
+#define CMPR_FN   vt_cmpr_integer
+#define ORDERED
+#define MAX_LOAD  0.5
+#define MALLOC_FN tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      separate_large_value_map_90
+#define KEY_TY    uint64_t
+#define VAL_TY    large_value
+#define HASH_FN   vt_hash_integer
+#define CMPR_FN   vt_cmpr_integer
+#define SEPARATE_VALUES
+#define MAX_LOAD  0.9
+#define MALLOC_FN tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+// Adapters that give Verstable maps and unordered_map a common interface for the benchmark function below.
+
+// VERSTABLE_ADAPTER_WITH_INIT's init_call argument initializes a table named table.
+// VERSTABLE_ADAPTER_WITH_VAL's val_access argument is the member access that yields the value an iterator points to.
+#define VERSTABLE_ADAPTER( name ) VERSTABLE_ADAPTER_WITH_INIT( name, "verstable", name##_init( &table ) )
+
+#define VERSTABLE_ADAPTER_WITH_INIT( name, label_string, init_call ) \
+VERSTABLE_ADAPTER_WITH_VAL( name, label_string, init_call, data->val )
+
+#define VERSTABLE_ADAPTER_WITH_VAL( name, label_string, init_call, val_access )                    \
+struct name##_adapter                                                                              \
+{                                                                                                  \
+  typedef name table_ty;                                                                           \
+                                                                                                   \
+  static const char *label()                                                                       \
+  {                                                                                                \
+    return label_string;                                                                           \
+  }                                                                                                \
+                                                                                                   \
+  static void init( table_ty &table, double )                                                      \
+  {                                                                                                \
+    init_call;                                                                                     \
+  }                                                                                                \
+                                                                                                   \
+  template<typename key_ty, typename val_ty>                                                       \
+  static void insert( table_ty &table, key_ty key, const val_ty &val )                             \
+  {                                                                                                \
+    ALWAYS_ASSERT( !name##_is_end( name##_insert( &table, key, val ) ) );                          \
+  }                                                                                                \
+                                                                                                   \
+  template<typename key_ty>                                                                        \
+  static uint64_t lookup_hit( table_ty &table, key_ty key )                                        \
+  {                                                                                                \
+    return checksum( name##_get( &table, key ).val_access );                                       \
+  }                                                                                                \
+                                                                                                   \
+  template<typename key_ty>                                                                        \
+  static uint64_t lookup_miss( table_ty &table, key_ty key )                                       \
+  {                                                                                                \
+    return name##_is_end( name##_get( &table, key ) );                                             \
+  }                                                                                                \
+                                                                                                   \
+  static uint64_t iterate( table_ty &table )                                                       \
+  {                                                                                                \
+    uint64_t sum = 0;                                                                              \
+    for( name##_itr itr = name##_first( &table ); !name##_is_end( itr ); itr = name##_next( itr ) ) \
+      sum += checksum( itr.val_access );                                                           \
+                                                                                                   \
+    return sum;                                                                                    \
+  }                                                                                                \
+                                                                                                   \
+  template<typename key_ty>                                                                        \
+  static void erase( table_ty &table, key_ty key )                                                 \
+  {                                                                                                \
+    name##_erase( &table, key );                                                                   \
+  }                                                                                                \
+                                                                                                   \
+  static void rehash( table_ty &table )                                                            \
+  {                                                                                                \
+    ALWAYS_ASSERT( name##_rehash( &table, name##_bucket_count( &table ) ) );                       \
+  }                                                                                                \
+                                                                                                   \
+  static void cleanup( table_ty &table )                                                           \
+  {                                                                                                \
+    name##_cleanup( &table );                                                                      \
+  }                                                                                                \
+};                                                                                                 \
+
+VERSTABLE_ADAPTER( integer_map_50 )
+VERSTABLE_ADAPTER( integer_map_75 )
+VERSTABLE_ADAPTER( integer_map_90 )
+VERSTABLE_ADAPTER_WITH_INIT(
+  huge_page_integer_map_90,
+  "verstable_huge_pages",
+  huge_page_integer_map_90_init( &table, vt_huge_page_ctx() ) // Zero threshold, i.e. VT_HUGE_PAGE_THRESHOLD.
+)
+VERSTABLE_ADAPTER( string_map_50 )
+VERSTABLE_ADAPTER( string_map_75 )
+VERSTABLE_ADAPTER( string_map_90 )
+VERSTABLE_ADAPTER_WITH_INIT( store_hash_string_map_90, "verstable_store_hash", store_hash_string_map_90_init( &table ) )
+VERSTABLE_ADAPTER_WITH_INIT( sso_string_map_90, "verstable_sso_string", sso_string_map_90_init( &table ) )
+VERSTABLE_ADAPTER( large_value_map_50 )
+VERSTABLE_ADAPTER_WITH_INIT(
+  ordered_large_value_map_50,
+  "verstable_ordered",
+  ordered_large_value_map_50_init( &table )
+)
+VERSTABLE_ADAPTER( large_value_map_75 )
+VERSTABLE_ADAPTER( large_value_map_90 )
+VERSTABLE_ADAPTER_WITH_VAL(
+  separate_large_value_map_90,
+  "verstable_separate_values",
+  separate_large_value_map_90_init( &table ),
+  val[ 0 ]
+)
+
+struct string_hash
+{
+  size_t operator()( char *key ) const
+  {
+    return (size_t)vt_hash_string( key );
+  }
+};
+
+struct string_cmpr
+{
+  bool operator()( char *key_1, char *key_2 ) const
+  {
+    return vt_cmpr_string( key_1, key_2 );
+  }
+};
+
+template<typename key_ty, typename val_ty, typename hash_ty, typename cmpr_ty> struct unordered_map_adapter
+{
+  typedef std::unordered_map<
+    key_ty,
+    val_ty,
+    hash_ty,
+    cmpr_ty,
+    tracking_allocator< std::pair<const key_ty, val_ty> >
+  > table_ty;
+
+  static const char *label()
+  {
+    return "std::unordered_map";
+  }
+
+  static void init( table_ty &table, double max_load )
+  {
+    table.max_load_factor( (float)max_load );
+  }
+
+  static void insert( table_ty &table, key_ty key, const val_ty &val )
+  {
+    table[ key ] = val;
+  }
+
+  static uint64_t lookup_hit( table_ty &table, key_ty key )
+  {
+    return checksum( table.find( key )->second );
+  }
+
+  static uint64_t lookup_miss( table_ty &table, key_ty key )
+  {
+    return table.find( key ) == table.end();
+  }
+
+  static uint64_t iterate( table_ty &table )
+  {
+    uint64_t sum = 0;
+    for( typename table_ty::iterator itr = table.begin(); itr != table.end(); ++itr )
+      sum += checksum( itr->second );
+
+    return sum;
+  }
+
+  static void erase( table_ty &table, key_ty key )
+  {
+    table.erase( key );
+  }
+
+  static void cleanup( table_ty &table )
+  {
+    table_ty().swap( table ); // Frees all memory.
+  }
+};
+
+typedef unordered_map_adapter<uint64_t, uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t> >
+  integer_unordered_map_adapter;
+typedef unordered_map_adapter<char *, uint64_t, string_hash, string_cmpr> string_unordered_map_adapter;
+typedef unordered_map_adapter<uint64_t, large_value, std::hash<uint64_t>, std::equal_to<uint64_t> >
+  large_value_unordered_map_adapter;
+
+// Benchmark function.
+
+enum operation
+{
+  INSERT,
+  REPLACE,
+  LOOKUP_HIT,
+  LOOKUP_MISS,
+  ITERATE,
+  ERASE,
+  N_OPERATIONS
+};
+
+static const char *operation_names[ N_OPERATIONS ] = {
+  "insert",
+  "replace",
+  "lookup_hit",
+  "lookup_miss",
+  "iterate",
+  "erase"
+};
+
+typedef std::chrono::steady_clock bench_clock;
+
+static double elapsed_ns( bench_clock::time_point start )
+{
+  return (double)std::chrono::duration_cast<std::chrono::nanoseconds>( bench_clock::now() - start ).count();
+}
+
+// Times each operation on a table of the adapter's type holding the specified keys and prints one CSV row per
+// operation.
+// keys holds the keys to insert in insertion order, shuffled_keys holds the same keys in random order, and
+// missing_keys holds the same number of keys not in the table.
+template<typename adapter, typename key_ty, typename val_ty>
+void benchmark(
+  const char *key_shape,
+  double max_load,
+  const std::vector<key_ty> &keys,
+  const std::vector<key_ty> &shuffled_keys,
+  const std::vector<key_ty> &missing_keys,
+  const val_ty &val
+)
+{
+  size_t size = keys.size();
+  size_t n_tables = std::max( (size_t)1, (size_t)OPS_PER_MEASUREMENT / size );
+
+  double best_ns[ N_OPERATIONS ];
+  std::fill( best_ns, best_ns + N_OPERATIONS, 1e300 );
+  size_t table_peak_bytes = 0;
+
+  for( int run = 0; run < N_RUNS; ++run )
+  {
+    double ns[ N_OPERATIONS ] = { 0 };
+    uint64_t sum = 0;
+
+    for( size_t t = 0; t < n_tables; ++t )
+    {
+      current_bytes = 0;
+      peak_bytes = 0;
+
+      typename adapter::table_ty table;
+      adapter::init( table, max_load );
+
+      bench_clock::time_point start = bench_clock::now();
+      for( size_t i = 0; i < size; ++i )
+        adapter::insert( table, keys[ i ], val );
+      ns[ INSERT ] += elapsed_ns( start );
+
+      start = bench_clock::now();
+      for( size_t i = 0; i < size; ++i )
+        adapter::insert( table, keys[ i ], val );
+      ns[ REPLACE ] += elapsed_ns( start );
+
+      start = bench_clock::now();
+      for( size_t i = 0; i < size; ++i )
+        sum += adapter::lookup_hit( table, shuffled_keys[ i ] );
+      ns[ LOOKUP_HIT ] += elapsed_ns( start );
+
+      start = bench_clock::now();
+      for( size_t i = 0; i < size; ++i )
+        sum += adapter::lookup_miss( table, missing_keys[ i ] );
+      ns[ LOOKUP_MISS ] += elapsed_ns( start );
+
+      start = bench_clock::now();
+      sum += adapter::iterate( table );
+      ns[ ITERATE ] += elapsed_ns( start );
+
+      start = bench_clock::now();
+      for( size_t i = 0; i < size; ++i )
+        adapter::erase( table, shuffled_keys[ i ] );
+      ns[ ERASE ] += elapsed_ns( start );
+
+      table_peak_bytes = peak_bytes;
+      adapter::cleanup( table );
+    }
+
+    sink = sink + sum;
+
+    for( int op = 0; op < N_OPERATIONS; ++op )
+      best_ns[ op ] = std::min( best_ns[ op ], ns[ op ] / ( (double)n_tables * size ) );
+  }
+
+  for( int op = 0; op < N_OPERATIONS; ++op )
+    printf(
+      "%s,%s,%zu,%.2f,%s,%.2f,%zu\n",
+      adapter::label(),
+      key_shape,
+      size,
+      max_load,
+      operation_names[ op ],
+      best_ns[ op ],
+      table_peak_bytes
+    );
+
+  fflush( stdout );
+}
+
+// Times rehashing a Verstable map holding the specified keys to its current bucket count and prints one CSV row.
+// As with benchmark, each measurement spans multiple rehashes for small tables.
+template<typename adapter, typename key_ty>
+void benchmark_rehash( const char *key_shape, double max_load, const std::vector<key_ty> &keys )
+{
+  size_t size = keys.size();
+  size_t n_rehashes = std::max( (size_t)1, (size_t)OPS_PER_MEASUREMENT / size );
+
+  current_bytes = 0;
+  peak_bytes = 0;
+
+  typename adapter::table_ty table;
+  adapter::init( table, max_load );
+  for( size_t i = 0; i < size; ++i )
+    adapter::insert( table, keys[ i ], (uint64_t)1 );
+
+  double best_ns = 1e300;
+  for( int run = 0; run < N_RUNS; ++run )
+  {
+    bench_clock::time_point start = bench_clock::now();
+    for( size_t r = 0; r < n_rehashes; ++r )
+      adapter::rehash( table );
+
+    best_ns = std::min( best_ns, elapsed_ns( start ) / ( (double)n_rehashes * size ) );
+  }
+
+  printf( "%s,%s,%zu,%.2f,rehash,%.2f,%zu\n", adapter::label(), key_shape, size, max_load, best_ns, peak_bytes );
+  fflush( stdout );
+
+  adapter::cleanup( table );
+}
+
+// Times GET_BATCH_LOOKUPS random lookups in a set of the specified number of integer keys, half of them hits and half
+// misses, via integer_set_90_get in a loop and via integer_set_90_get_batch, and prints one CSV row for each.
+static void benchmark_get_batch( size_t size )
+{
+  current_bytes = 0;
+  peak_bytes = 0;
+
+  integer_set_90 table;
+  integer_set_90_init( &table );
+  ALWAYS_ASSERT( integer_set_90_reserve( &table, size ) );
+  for( size_t i = 0; i < size; ++i )
+    ALWAYS_ASSERT( !integer_set_90_is_end( integer_set_90_insert( &table, vt_hash_integer( i ) ) ) );
+
+  // Even-numbered lookups are of random keys in the table, and odd-numbered lookups are of random keys not in it.
+  std::vector<uint64_t> lookup_keys( GET_BATCH_LOOKUPS );
+  uint64_t state = 0x9E3779B97F4A7C15ull;
+  for( size_t i = 0; i < GET_BATCH_LOOKUPS; ++i )
+  {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    size_t index = ( state >> 16 ) % size;
+    lookup_keys[ i ] = vt_hash_integer( i % 2 ? size + index : index );
+  }
+
+  std::vector<integer_set_90_itr> itrs( GET_BATCH_SIZE );
+  double loop_ns = 1e300;
+  double batch_ns = 1e300;
+
+  for( int run = 0; run < N_RUNS; ++run )
+  {
+    uint64_t hits = 0;
+
+    bench_clock::time_point start = bench_clock::now();
+    for( size_t i = 0; i < GET_BATCH_LOOKUPS; ++i )
+      hits += !integer_set_90_is_end( integer_set_90_get( &table, lookup_keys[ i ] ) );
+    loop_ns = std::min( loop_ns, elapsed_ns( start ) / GET_BATCH_LOOKUPS );
+    ALWAYS_ASSERT( hits == GET_BATCH_LOOKUPS / 2 );
+
+    hits = 0;
+    start = bench_clock::now();
+    for( size_t i = 0; i < GET_BATCH_LOOKUPS; i += GET_BATCH_SIZE )
+    {
+      size_t n = std::min( (size_t)GET_BATCH_SIZE, GET_BATCH_LOOKUPS - i );
+      integer_set_90_get_batch( &table, &lookup_keys[ i ], n, &itrs[ 0 ] );
+      for( size_t j = 0; j < n; ++j )
+        hits += !integer_set_90_is_end( itrs[ j ] );
+    }
+    batch_ns = std::min( batch_ns, elapsed_ns( start ) / GET_BATCH_LOOKUPS );
+    ALWAYS_ASSERT( hits == GET_BATCH_LOOKUPS / 2 );
+  }
+
+  printf( "verstable,integer_set,%zu,0.90,get_loop,%.2f,%zu\n", size, loop_ns, peak_bytes );
+  printf( "verstable,integer_set,%zu,0.90,get_batch,%.2f,%zu\n", size, batch_ns, peak_bytes );
+  fflush( stdout );
+
+  integer_set_90_cleanup( &table );
+}
+
+// Times iteration over an integer map with ITERATION_BUCKET_COUNT buckets at each load in iteration_loads and prints
+// one CSV row per load.
+#define ITERATION_BUCKET_COUNT ( (size_t)1 << 20 )
+static const double iteration_loads[] = { 0.01, 0.05, 0.25, 0.9 };
+
+static void benchmark_iteration()
+{
+  #if VT_METADATA_SCAN_WIDTH == 8
+  const char *label = "verstable_scan_sse2";
+  #else
+  const char *label = "verstable_scan_scalar";
+  #endif
+
+  for( size_t l = 0; l < sizeof( iteration_loads ) / sizeof( *iteration_loads ); ++l )
+  {
+    size_t size = (size_t)( ITERATION_BUCKET_COUNT * iteration_loads[ l ] );
+    size_t n_iterations = std::max( (size_t)1, (size_t)OPS_PER_MEASUREMENT * 10 / size );
+
+    current_bytes = 0;
+    peak_bytes = 0;
+
+    integer_map_90 table;
+    integer_map_90_init( &table );
+    ALWAYS_ASSERT( integer_map_90_reserve( &table, (size_t)( ITERATION_BUCKET_COUNT * 0.9 ) ) );
+    ALWAYS_ASSERT( integer_map_90_bucket_count( &table ) == ITERATION_BUCKET_COUNT );
+    for( size_t i = 0; i < size; ++i )
+      ALWAYS_ASSERT( !integer_map_90_is_end( integer_map_90_insert( &table, vt_hash_integer( i ), i ) ) );
+
+    double best_ns = 1e300;
+    for( int run = 0; run < N_RUNS; ++run )
+    {
+      uint64_t sum = 0;
+      bench_clock::time_point start = bench_clock::now();
+      for( size_t i = 0; i < n_iterations; ++i )
+        for(
+          integer_map_90_itr itr = integer_map_90_first( &table );
+          !integer_map_90_is_end( itr );
+          itr = integer_map_90_next( itr )
+        )
+          sum += itr.data->val;
+
+      best_ns = std::min( best_ns, elapsed_ns( start ) / ( (double)n_iterations * size ) );
+      sink = sink + sum;
+    }
+
+    printf(
+      "%s,integer,%zu,%.2f,iterate,%.2f,%zu\n",
+      label,
+      size,
+      iteration_loads[ l ],
+      best_ns,
+      peak_bytes
+    );
+    fflush( stdout );
+
+    integer_map_90_cleanup( &table );
+  }
+}
+
+// Key generation.
+// Integer keys are distinct because the mixing function used to generate them is a bijection.
+// String keys are the hexadecimal representations of integer keys, zero-padded to the specified length.
+
+static std::vector<uint64_t> integer_keys( size_t first, size_t count )
+{
+  std::vector<uint64_t> keys( count );
+  for( size_t i = 0; i < count; ++i )
+    keys[ i ] = vt_hash_integer( first + i );
+
+  return keys;
+}
+
+static std::vector<char *> string_keys(
+  const std::vector<uint64_t> &integer_keys,
+  std::vector<char> &storage,
+  size_t length = 16
+)
+{
+  storage.resize( integer_keys.size() * ( length + 1 ) );
+
+  std::vector<char *> keys( integer_keys.size() );
+  for( size_t i = 0; i < integer_keys.size(); ++i )
+  {
+    keys[ i ] = &storage[ i * ( length + 1 ) ];
+    snprintf( keys[ i ], length + 1, "%0*llx", (int)length, (unsigned long long)integer_keys[ i ] );
+  }
+
+  return keys;
+}
+
+// The strings are short enough to be stored inline, so borrowing them still copies them and allocates nothing.
+static std::vector<vt_sso_string> sso_string_keys( const std::vector<char *> &string_keys )
+{
+  std::vector<vt_sso_string> keys( string_keys.size() );
+  for( size_t i = 0; i < string_keys.size(); ++i )
+    ALWAYS_ASSERT( vt_sso_string_borrow( &keys[ i ], string_keys[ i ], strlen( string_keys[ i ] ) ) );
+
+  return keys;
+}
+
+template<typename key_ty> static std::vector<key_ty> shuffled( std::vector<key_ty> keys )
+{
+  // Fisher-Yates shuffle with a fixed seed so that results are reproducible.
+  uint64_t state = 0x9E3779B97F4A7C15ull;
+  for( size_t i = keys.size(); i > 1; --i )
+  {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    std::swap( keys[ i - 1 ], keys[ ( state >> 33 ) % i ] );
+  }
+
+  return keys;
+}
+
+int main()
+{
+  printf( "table,key_shape,size,max_load,operation,ns_per_op,peak_bytes\n" );
+
+  for( size_t s = 0; s < sizeof( sizes ) / sizeof( *sizes ); ++s )
+  {
+    size_t size = sizes[ s ];
+
+    // Integer keys.
+    std::vector<uint64_t> keys = integer_keys( 0, size );
+    std::vector<uint64_t> shuffled_keys = shuffled( keys );
+    std::vector<uint64_t> missing_keys = integer_keys( size, size );
+    uint64_t val = 1;
+
+    benchmark<integer_map_50_adapter>( "integer", 0.5, keys, shuffled_keys, missing_keys, val );
+    benchmark<integer_unordered_map_adapter>( "integer", 0.5, keys, shuffled_keys, missing_keys, val );
+    benchmark<integer_map_75_adapter>( "integer", 0.75, keys, shuffled_keys, missing_keys, val );
+    benchmark<integer_unordered_map_adapter>( "integer", 0.75, keys, shuffled_keys, missing_keys, val );
+    benchmark<integer_map_90_adapter>( "integer", 0.9, keys, shuffled_keys, missing_keys, val );
+    benchmark<huge_page_integer_map_90_adapter>( "integer", 0.9, keys, shuffled_keys, missing_keys, val );
+    benchmark<integer_unordered_map_adapter>( "integer", 0.9, keys, shuffled_keys, missing_keys, val );
+
+    // String keys.
+    std::vector<char> storage;
+    std::vector<char> missing_storage;
+    std::vector<char *> str_keys = string_keys( keys, storage );
+    std::vector<char *> shuffled_str_keys = shuffled( str_keys );
+    std::vector<char *> missing_str_keys = string_keys( missing_keys, missing_storage );
+
+    benchmark<string_map_50_adapter>( "string", 0.5, str_keys, shuffled_str_keys, missing_str_keys, val );
+    benchmark<string_unordered_map_adapter>( "string", 0.5, str_keys, shuffled_str_keys, missing_str_keys, val );
+    benchmark<string_map_75_adapter>( "string", 0.75, str_keys, shuffled_str_keys, missing_str_keys, val );
+    benchmark<string_unordered_map_adapter>( "string", 0.75, str_keys, shuffled_str_keys, missing_str_keys, val );
+    benchmark<string_map_90_adapter>( "string", 0.9, str_keys, shuffled_str_keys, missing_str_keys, val );
+    benchmark<sso_string_map_90_adapter>(
+      "string",
+      0.9,
+      sso_string_keys( str_keys ),
+      sso_string_keys( shuffled_str_keys ),
+      sso_string_keys( missing_str_keys ),
+      val
+    );
+    benchmark<string_unordered_map_adapter>( "string", 0.9, str_keys, shuffled_str_keys, missing_str_keys, val );
+
+    // Rehashing string keys, with and without STORE_HASH.
+    std::vector<char> long_storage;
+    std::vector<char *> long_str_keys = string_keys( keys, long_storage, 64 );
+
+    benchmark_rehash<string_map_90_adapter>( "string", 0.9, str_keys );
+    benchmark_rehash<store_hash_string_map_90_adapter>( "string", 0.9, str_keys );
+    benchmark_rehash<string_map_90_adapter>( "long_string", 0.9, long_str_keys );
+    benchmark_rehash<store_hash_string_map_90_adapter>( "long_string", 0.9, long_str_keys );
+
+    // Large values.
+    large_value large_val;
+    for( size_t i = 0; i < sizeof( large_val.data ) / sizeof( *large_val.data ); ++i )
+      large_val.data[ i ] = i;
+
+    benchmark<large_value_map_50_adapter>( "large_value", 0.5, keys, shuffled_keys, missing_keys, large_val );
+    benchmark<ordered_large_value_map_50_adapter>( "large_value", 0.5, keys, shuffled_keys, missing_keys, large_val );
+    benchmark<large_value_unordered_map_adapter>( "large_value", 0.5, keys, shuffled_keys, missing_keys, large_val );
+    benchmark<large_value_map_75_adapter>( "large_value", 0.75, keys, shuffled_keys, missing_keys, large_val );
+    benchmark<large_value_unordered_map_adapter>( "large_value", 0.75, keys, shuffled_keys, missing_keys, large_val );
+    benchmark<large_value_map_90_adapter>( "large_value", 0.9, keys, shuffled_keys, missing_keys, large_val );
+    benchmark<separate_large_value_map_90_adapter>( "large_value", 0.9, keys, shuffled_keys, missing_keys, large_val );
+    benchmark<large_value_unordered_map_adapter>( "large_value", 0.9, keys, shuffled_keys, missing_keys, large_val );
+  }
+
+  for( size_t s = 0; s < sizeof( get_batch_sizes ) / sizeof( *get_batch_sizes ); ++s )
+    benchmark_get_batch( get_batch_sizes[ s ] );
+
+  benchmark_iteration();
+}
@@ -0,0 +1,461 @@
+/*
+
+Verstable v2.1.1 - bench/concurrent_benchmarks.cpp
+
+This file measures the throughput of concurrent Verstable maps, i.e. maps instantiated with the CONCURRENT_SHARDS or
+SEQLOCK option, as the number of threads accessing them grows, as well as the throughput of the parallel functions
+provided by the PARALLEL option as the number of threads that they use grows.
+A map with one shard is equivalent to a single map guarded by one global mutex and serves as the baseline.
+
+There are four workloads:
+* mixed: Each thread performs a random mix of lookups, insertions, and erasures on keys drawn from a shared pool, half
+  of which are initially in the map, so that the map's size stays roughly constant.
+  The proportion of operations that are insertions or erasures (write_fraction) is varied.
+  Only the sharded maps support this workload, since a SEQLOCK map allows only one writer.
+* single_writer: One thread repeatedly inserts and erases keys while the other threads only perform lookups.
+  Only the lookups are counted.
+* build: NAME_build_parallel inserts the whole key pool into an empty map.
+  With one thread, the keys are inserted in a loop, which serves as the baseline.
+* rehash: NAME_reserve_parallel quadruples the bucket count of a map containing the whole key pool.
+  Each key counts as one operation.
+The results, in millions of operations per second across all counted threads, are printed to stdout in CSV format.
+
+Compile with optimizations and run, e.g.:
+
+  g++ -std=c++11 -O3 -DNDEBUG -pthread bench/concurrent_benchmarks.cpp -o concurrent_benchmarks &&
+  ./concurrent_benchmarks > results.csv
+
+Scaling is limited by the number of hardware threads available, so the results are only meaningful up to that number.
+
+License (MIT):
+
+  Copyright (c) 2023-2024 Jackson L. Allan
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+  documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+  persons to whom the Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+  Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+  OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Assert macro that is not disabled by NDEBUG.
+#define ALWAYS_ASSERT( xp )                                                                                     \
+( (xp) ? (void)0 : ( std::cerr << "Assertion failed at line " << __LINE__ << ": " << #xp << '\n', exit( 1 ) ) ) \
+
+// The total number of operations per measurement, divided evenly among the threads, and the number of measurements of
+// which the fastest is reported.
+#define OPS_PER_MEASUREMENT 4000000
+#define N_RUNS 3
+
+// The number of keys initially in the map.
+#define SIZE 1000000
+
+static const unsigned thread_counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+static const double write_fractions[] = { 0.0, 0.1, 0.5 };
+
+// Verstable map templates.
+
+#define NAME              map_1_shard
+#define KEY_TY            uint64_t
+#define VAL_TY            uint64_t
+#define HASH_FN           vt_hash_integer
+#define CMPR_FN           vt_cmpr_integer
+#define CONCURRENT_SHARDS 1
+#include "../verstable.h"
+
+#define NAME              map_16_shards
+#define KEY_TY            uint64_t
+#define VAL_TY            uint64_t
+#define HASH_FN           vt_hash_integer
+#define CMPR_FN           vt_cmpr_integer
+#define CONCURRENT_SHARDS 16
+#include "../verstable.h"
+
+#define NAME              map_64_shards
+#define KEY_TY            uint64_t
+#define VAL_TY            uint64_t
+#define HASH_FN           vt_hash_integer
+#define CMPR_FN           vt_cmpr_integer
+#define CONCURRENT_SHARDS 64
+#include "../verstable.h"
+
+#define NAME              map_256_shards
+#define KEY_TY            uint64_t
+#define VAL_TY            uint64_t
+#define HASH_FN           vt_hash_integer
+#define CMPR_FN           vt_cmpr_integer
+#define CONCURRENT_SHARDS 256
+#include "../verstable.h"
+
+#define NAME    map_seqlock
+#define KEY_TY  uint64_t
+#define VAL_TY  uint64_t
+#define HASH_FN vt_hash_integer
+#define CMPR_FN vt_cmpr_integer
+#define SEQLOCK
+#include "../verstable.h"
+
+#define NAME    map_parallel
+#define KEY_TY  uint64_t
+#define VAL_TY  uint64_t
+#define HASH_FN vt_hash_integer
+#define CMPR_FN vt_cmpr_integer
+#define PARALLEL
+#include "../verstable.h"
+
+// Adapters providing a uniform interface to each map type.
+
+#define VERSTABLE_ADAPTER( name, label_str )                                   \
+struct name##_adapter                                                          \
+{                                                                              \
+  typedef name##_concurrent table_ty;                                          \
+  static const char *label(){ return label_str; }                              \
+  static void init( table_ty &table )                                          \
+  {                                                                            \
+    ALWAYS_ASSERT( name##_concurrent_init( &table ) );                         \
+  }                                                                            \
+  static void insert( table_ty &table, uint64_t key, uint64_t val )            \
+  {                                                                            \
+    ALWAYS_ASSERT( name##_concurrent_insert( &table, key, val ) );             \
+  }                                                                            \
+  static uint64_t get( table_ty &table, uint64_t key )                         \
+  {                                                                            \
+    uint64_t val = 0;                                                          \
+    name##_concurrent_get( &table, key, &val );                                \
+    return val;                                                                \
+  }                                                                            \
+  static void erase( table_ty &table, uint64_t key )                           \
+  {                                                                            \
+    name##_concurrent_erase( &table, key );                                    \
+  }                                                                            \
+  static size_t size( table_ty &table )                                        \
+  {                                                                            \
+    return name##_concurrent_size( &table );                                   \
+  }                                                                            \
+  static void cleanup( table_ty &table )                                       \
+  {                                                                            \
+    name##_concurrent_cleanup( &table );                                       \
+  }                                                                            \
+};                                                                             \
+
+VERSTABLE_ADAPTER( map_1_shard, "verstable_1_shard" )
+VERSTABLE_ADAPTER( map_16_shards, "verstable_16_shards" )
+VERSTABLE_ADAPTER( map_64_shards, "verstable_64_shards" )
+VERSTABLE_ADAPTER( map_256_shards, "verstable_256_shards" )
+
+struct map_seqlock_adapter
+{
+  typedef map_seqlock table_ty;
+  static const char *label(){ return "verstable_seqlock"; }
+  static void init( table_ty &table )
+  {
+    map_seqlock_init( &table );
+  }
+  static void insert( table_ty &table, uint64_t key, uint64_t val )
+  {
+    ALWAYS_ASSERT( !map_seqlock_is_end( map_seqlock_insert( &table, key, val ) ) );
+  }
+  static uint64_t get( table_ty &table, uint64_t key )
+  {
+    uint64_t val = 0;
+    map_seqlock_get_concurrent( &table, key, &val );
+    return val;
+  }
+  static void erase( table_ty &table, uint64_t key )
+  {
+    map_seqlock_erase( &table, key );
+  }
+  static size_t size( table_ty &table )
+  {
+    return map_seqlock_size( &table );
+  }
+  static void cleanup( table_ty &table )
+  {
+    map_seqlock_cleanup( &table );
+  }
+};
+
+// Sink for checksums to prevent the compiler from optimizing away lookups.
+std::atomic<uint64_t> sink( 0 );
+
+typedef std::chrono::steady_clock bench_clock;
+
+// Performs n_ops random operations on the table, using keys from the pool.
+// Each thread uses a different seed for its pseudo-random number generator.
+template<typename adapter>
+static void worker(
+  typename adapter::table_ty *table,
+  const std::vector<uint64_t> *pool,
+  size_t n_ops,
+  double write_fraction,
+  uint64_t seed,
+  std::atomic<bool> *start
+)
+{
+  uint64_t write_threshold = (uint64_t)( write_fraction * 0x100000000ull );
+  uint64_t state = seed;
+  uint64_t sum = 0;
+
+  while( !start->load() )
+    std::this_thread::yield();
+
+  for( size_t i = 0; i < n_ops; ++i )
+  {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    uint64_t key = ( *pool )[ ( state >> 33 ) % pool->size() ];
+
+    // Use the low bits of the key (which is itself a hash) to choose between insertion and erasure so that a given
+    // key is always either inserted or erased, rather than alternating.
+    if( ( ( state >> 1 ) & 0xFFFFFFFF ) < write_threshold )
+    {
+      if( key & 1 )
+        adapter::insert( *table, key, i );
+      else
+        adapter::erase( *table, key );
+    }
+    else
+      sum += adapter::get( *table, key );
+  }
+
+  sink += sum;
+}
+
+// Measures and prints the throughput of the adapter's table type for each thread count and write fraction.
+template<typename adapter> static void benchmark( const std::vector<uint64_t> &pool )
+{
+  for( size_t w = 0; w < sizeof( write_fractions ) / sizeof( *write_fractions ); ++w )
+    for( size_t t = 0; t < sizeof( thread_counts ) / sizeof( *thread_counts ); ++t )
+    {
+      unsigned n_threads = thread_counts[ t ];
+      double best_mops = 0.0;
+
+      for( int run = 0; run < N_RUNS; ++run )
+      {
+        typename adapter::table_ty table;
+        adapter::init( table );
+        for( size_t i = 0; i < SIZE; ++i )
+          adapter::insert( table, pool[ i ], i );
+
+        std::atomic<bool> start( false );
+        std::vector<std::thread> threads;
+        for( unsigned i = 0; i < n_threads; ++i )
+          threads.push_back(
+            std::thread(
+              worker<adapter>,
+              &table,
+              &pool,
+              OPS_PER_MEASUREMENT / n_threads,
+              write_fractions[ w ],
+              i + 1,
+              &start
+            )
+          );
+
+        bench_clock::time_point start_time = bench_clock::now();
+        start = true;
+        for( unsigned i = 0; i < n_threads; ++i )
+          threads[ i ].join();
+        double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+          bench_clock::now() - start_time
+        ).count();
+
+        // Check that the table's size is plausible, i.e. that no concurrent operation corrupted it.
+        ALWAYS_ASSERT( adapter::size( table ) <= pool.size() );
+        if( write_fractions[ w ] == 0.0 )
+          ALWAYS_ASSERT( adapter::size( table ) == SIZE );
+
+        adapter::cleanup( table );
+
+        double mops = (double)( OPS_PER_MEASUREMENT / n_threads * n_threads ) / ns * 1000.0;
+        best_mops = std::max( best_mops, mops );
+      }
+
+      printf( "%s,mixed,%u,%.2f,%.2f\n", adapter::label(), n_threads, write_fractions[ w ], best_mops );
+      fflush( stdout );
+    }
+}
+
+// Performs n_ops lookups of random keys from the pool, checking that each key found has the value that the writer
+// associates with it (i.e. the key itself).
+template<typename adapter>
+static void reader(
+  typename adapter::table_ty *table,
+  const std::vector<uint64_t> *pool,
+  size_t n_ops,
+  uint64_t seed,
+  std::atomic<bool> *start
+)
+{
+  uint64_t state = seed;
+  uint64_t sum = 0;
+
+  while( !start->load() )
+    std::this_thread::yield();
+
+  for( size_t i = 0; i < n_ops; ++i )
+  {
+    state = state * 6364136223846793005ull + 1442695040888963407ull;
+    uint64_t key = ( *pool )[ ( state >> 33 ) % pool->size() ];
+
+    uint64_t val = adapter::get( *table, key );
+    ALWAYS_ASSERT( val == 0 || val == key );
+    sum += val;
+  }
+
+  sink += sum;
+}
+
+// Repeatedly inserts all keys in the second half of the pool, which are initially absent from the table, and then
+// erases them, until stop is set.
+template<typename adapter>
+static void writer(
+  typename adapter::table_ty *table,
+  const std::vector<uint64_t> *pool,
+  std::atomic<bool> *start,
+  std::atomic<bool> *stop
+)
+{
+  while( !start->load() )
+    std::this_thread::yield();
+
+  for( size_t i = 0; !stop->load( std::memory_order_relaxed ); ++i )
+  {
+    uint64_t key = ( *pool )[ SIZE + i % SIZE ];
+    if( ( i / SIZE ) % 2 == 0 )
+      adapter::insert( *table, key, key );
+    else
+      adapter::erase( *table, key );
+  }
+}
+
+// Measures and prints the lookup throughput of the adapter's table type for each thread count (including the writer
+// thread) under the single-writer workload.
+template<typename adapter> static void benchmark_single_writer( const std::vector<uint64_t> &pool )
+{
+  for( size_t t = 0; t < sizeof( thread_counts ) / sizeof( *thread_counts ); ++t )
+  {
+    unsigned n_threads = thread_counts[ t ];
+    if( n_threads < 2 )
+      continue;
+
+    unsigned n_readers = n_threads - 1;
+    double best_mops = 0.0;
+
+    for( int run = 0; run < N_RUNS; ++run )
+    {
+      typename adapter::table_ty table;
+      adapter::init( table );
+      for( size_t i = 0; i < SIZE; ++i )
+        adapter::insert( table, pool[ i ], pool[ i ] );
+
+      std::atomic<bool> start( false );
+      std::atomic<bool> stop( false );
+      std::thread writer_thread( writer<adapter>, &table, &pool, &start, &stop );
+      std::vector<std::thread> reader_threads;
+      for( unsigned i = 0; i < n_readers; ++i )
+        reader_threads.push_back(
+          std::thread( reader<adapter>, &table, &pool, OPS_PER_MEASUREMENT / n_readers, i + 1, &start )
+        );
+
+      bench_clock::time_point start_time = bench_clock::now();
+      start = true;
+      for( unsigned i = 0; i < n_readers; ++i )
+        reader_threads[ i ].join();
+      double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        bench_clock::now() - start_time
+      ).count();
+
+      stop = true;
+      writer_thread.join();
+
+      ALWAYS_ASSERT( adapter::size( table ) >= SIZE && adapter::size( table ) <= pool.size() );
+      adapter::cleanup( table );
+
+      double mops = (double)( OPS_PER_MEASUREMENT / n_readers * n_readers ) / ns * 1000.0;
+      best_mops = std::max( best_mops, mops );
+    }
+
+    printf( "%s,single_writer,%u,,%.2f\n", adapter::label(), n_threads, best_mops );
+    fflush( stdout );
+  }
+}
+
+// Measures and prints the throughput of NAME_build_parallel and NAME_reserve_parallel for each thread count.
+static void benchmark_parallel( const std::vector<uint64_t> &pool )
+{
+  std::vector<uint64_t> keys( pool );
+  std::vector<uint64_t> vals( pool );
+
+  for( size_t t = 0; t < sizeof( thread_counts ) / sizeof( *thread_counts ); ++t )
+  {
+    unsigned n_threads = thread_counts[ t ];
+    double best_build_mops = 0.0;
+    double best_rehash_mops = 0.0;
+
+    for( int run = 0; run < N_RUNS; ++run )
+    {
+      map_parallel table;
+      map_parallel_init( &table );
+
+      bench_clock::time_point start_time = bench_clock::now();
+      ALWAYS_ASSERT( map_parallel_build_parallel( &table, keys.data(), vals.data(), keys.size(), n_threads ) );
+      double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        bench_clock::now() - start_time
+      ).count();
+
+      ALWAYS_ASSERT( map_parallel_size( &table ) == pool.size() );
+      best_build_mops = std::max( best_build_mops, (double)pool.size() / ns * 1000.0 );
+
+      start_time = bench_clock::now();
+      ALWAYS_ASSERT( map_parallel_reserve_parallel( &table, map_parallel_bucket_count( &table ) * 3, n_threads ) );
+      ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>( bench_clock::now() - start_time ).count();
+
+      ALWAYS_ASSERT( map_parallel_size( &table ) == pool.size() );
+      best_rehash_mops = std::max( best_rehash_mops, (double)pool.size() / ns * 1000.0 );
+
+      map_parallel_cleanup( &table );
+    }
+
+    printf( "map_parallel,build,%u,,%.2f\n", n_threads, best_build_mops );
+    printf( "map_parallel,rehash,%u,,%.2f\n", n_threads, best_rehash_mops );
+    fflush( stdout );
+  }
+}
+
+int main()
+{
+  // The key pool consists of distinct keys because the mixing function used to generate them is a bijection.
+  std::vector<uint64_t> pool( SIZE * 2 );
+  for( size_t i = 0; i < pool.size(); ++i )
+    pool[ i ] = vt_hash_integer( i );
+
+  printf( "table,workload,threads,write_fraction,mops_per_s\n" );
+
+  benchmark<map_1_shard_adapter>( pool );
+  benchmark<map_16_shards_adapter>( pool );
+  benchmark<map_64_shards_adapter>( pool );
+  benchmark<map_256_shards_adapter>( pool );
+
+  benchmark_single_writer<map_1_shard_adapter>( pool );
+  benchmark_single_writer<map_64_shards_adapter>( pool );
+  benchmark_single_writer<map_seqlock_adapter>( pool );
+
+  benchmark_parallel( pool );
+}
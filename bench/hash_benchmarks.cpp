@@ -0,0 +1,141 @@
+/*
+
+Verstable v2.1.1 - bench/hash_benchmarks.cpp
+
+This file measures the throughput of Verstable's byte-sequence hash function, vt_hash_bytes, against the byte-at-a-time
+FNV-1a function that vt_hash_string used before it was rebuilt on vt_hash_bytes, across a range of key lengths.
+
+There are three hash functions:
+* fnv1a: FNV-1a over the key's bytes, given the key's length.
+* vt_hash_bytes: vt_hash_bytes over the key's bytes, given the key's length.
+* vt_hash_string: vt_hash_string over the NULL-terminated key, which includes the cost of finding its length.
+
+For each length, each function hashes a pool of distinct random keys, independently of one another, repeatedly.
+The results, in nanoseconds per key and bytes per nanosecond, are printed to stdout in CSV format.
+
+Compile with optimizations and run, e.g.:
+
+  g++ -std=c++11 -O3 -DNDEBUG bench/hash_benchmarks.cpp -o hash_benchmarks && ./hash_benchmarks > results.csv
+
+License (MIT):
+
+  Copyright (c) 2023-2024 Jackson L. Allan
+
+  Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+  documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+  rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+  persons to whom the Software is furnished to do so, subject to the following conditions:
+
+  The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+  Software.
+
+  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+  WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+  COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+  OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// The number of keys hashed per measurement and the number of measurements of which the fastest is reported.
+#define HASHES_PER_MEASUREMENT 4000000
+#define N_RUNS 5
+
+// The number of distinct keys of each length, which is small enough for the keys to stay in the CPU cache.
+#define POOL_SIZE 1024
+
+// Key lengths to benchmark.
+// URL-like keys are typically 40 to 100 bytes long.
+static const size_t lengths[] = { 1, 4, 8, 12, 16, 24, 32, 48, 64, 100, 128, 256, 1024 };
+
+// A template instance is needed to include the library, although only its hash functions are benchmarked.
+#define NAME    unused_map
+#define KEY_TY  uint64_t
+#define HASH_FN vt_hash_integer
+#define CMPR_FN vt_cmpr_integer
+#include "../verstable.h"
+
+volatile uint64_t sink;
+
+// Hash function wrappers with a common signature.
+
+static inline uint64_t fnv1a( char *key, size_t length )
+{
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for( size_t i = 0; i < length; ++i )
+    hash = ( (unsigned char)key[ i ] ^ hash ) * 0x100000001b3ull;
+
+  return hash;
+}
+
+static inline uint64_t hash_bytes( char *key, size_t length )
+{
+  return vt_hash_bytes( key, length );
+}
+
+static inline uint64_t hash_string( char *key, size_t )
+{
+  return vt_hash_string( key );
+}
+
+typedef std::chrono::steady_clock bench_clock;
+
+// Hashes the keys, each of which is length characters long and NULL-terminated, and prints one CSV row.
+template<uint64_t ( *hash_fn )( char *, size_t )>
+void benchmark( const char *label, const std::vector<char *> &keys, size_t length )
+{
+  size_t rounds = std::max( (size_t)1, (size_t)HASHES_PER_MEASUREMENT / keys.size() );
+  double best_ns = 1e300;
+
+  for( int run = 0; run < N_RUNS; ++run )
+  {
+    uint64_t sum = 0;
+    bench_clock::time_point start = bench_clock::now();
+
+    for( size_t round = 0; round < rounds; ++round )
+      for( size_t i = 0; i < keys.size(); ++i )
+        sum += hash_fn( keys[ i ], length );
+
+    double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>( bench_clock::now() - start ).count();
+    sink = sink + sum;
+    best_ns = std::min( best_ns, ns / ( (double)rounds * keys.size() ) );
+  }
+
+  printf( "%s,%zu,%.2f,%.2f\n", label, length, best_ns, length / best_ns );
+  fflush( stdout );
+}
+
+int main()
+{
+  printf( "hash,length,ns_per_key,bytes_per_ns\n" );
+
+  // Random printable characters from a fixed-seed generator so that results are reproducible.
+  uint64_t state = 0x9E3779B97F4A7C15ull;
+
+  for( size_t l = 0; l < sizeof( lengths ) / sizeof( *lengths ); ++l )
+  {
+    size_t length = lengths[ l ];
+
+    std::vector<char> storage( POOL_SIZE * ( length + 1 ) );
+    std::vector<char *> keys( POOL_SIZE );
+    for( size_t i = 0; i < POOL_SIZE; ++i )
+    {
+      keys[ i ] = &storage[ i * ( length + 1 ) ];
+      for( size_t j = 0; j < length; ++j )
+      {
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        keys[ i ][ j ] = (char)( 'a' + ( state >> 33 ) % 26 );
+      }
+
+      keys[ i ][ length ] = '\0';
+    }
+
+    benchmark<fnv1a>( "fnv1a", keys, length );
+    benchmark<hash_bytes>( "vt_hash_bytes", keys, length );
+    benchmark<hash_string>( "vt_hash_string", keys, length );
+  }
+}
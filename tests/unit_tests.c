@@ -28,6 +28,7 @@ License (MIT):
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
 // Assert macro that is not disabled by NDEBUG.
@@ -126,6 +127,20 @@ void check_dtors_arr( void )
 // Set to 1.0 to test correct handling of rehashing due to displacement limit violation.
 #define GLOBAL_MAX_LOAD 0.95
 
+// Migrate only a few buckets per operation during incremental rehashes so that each rehash spans many operations even
+// in small tables.
+#define VT_INCREMENTAL_REHASH_STEP 4
+
+// Enable the event counters reported by vt_stats.
+#define VT_ENABLE_COUNTERS
+
+// Provide the huge-page allocator.
+#define VT_ENABLE_HUGE_PAGES
+
+// Allow parallel rehashes to use many threads even in small tables, so that the threads' bucket ranges are narrow and
+// many keys are deferred to the calling thread.
+#define VT_PARALLEL_MIN_BUCKETS_PER_THREAD 64
+
 // Instantiate hash table templates.
 
 #define NAME      integer_map
@@ -193,8 +208,434 @@ void check_dtors_arr( void )
 #define FREE_FN   tracking_free_with_ctx
 #include "../verstable.h"
 
+// Hash function that counts the number of times it has been called, used to check that tables that store hash codes
+// never rehash keys already in the table.
+
+size_t hash_calls = 0;
+
+uint64_t counting_hash( uint64_t key )
+{
+  ++hash_calls;
+  return vt_hash_integer( key );
+}
+
+#define NAME      integer_map_with_stored_hash
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define HASH_FN   counting_hash
+#define STORE_HASH
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      integer_set_with_stored_hash
+#define KEY_TY    uint64_t
+#define HASH_FN   counting_hash
+#define STORE_HASH
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      integer_map_incremental
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define INCREMENTAL_REHASH
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      integer_set_incremental
+#define KEY_TY    uint64_t
+#define INCREMENTAL_REHASH
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+// Concurrent (sharded) tables.
+// These tests only access the tables from one thread because the tracking allocation functions are not thread-safe.
+// bench/concurrent_benchmarks.cpp exercises them from multiple threads.
+
+#define NAME              shard_integer_map
+#define KEY_TY            uint64_t
+#define VAL_TY            uint64_t
+#define CONCURRENT_SHARDS 4
+#define MAX_LOAD          GLOBAL_MAX_LOAD
+#define MALLOC_FN         unreliable_tracking_malloc
+#define FREE_FN           tracking_free
+#include "../verstable.h"
+
+#define NAME              shard_integer_set
+#define KEY_TY            uint64_t
+#define CONCURRENT_SHARDS 4
+#define MAX_LOAD          GLOBAL_MAX_LOAD
+#define MALLOC_FN         unreliable_tracking_malloc
+#define FREE_FN           tracking_free
+#include "../verstable.h"
+
+// Tables supporting lock-free reads.
+// As with the concurrent tables, these tests access the tables from one thread.
+
+#define NAME      integer_map_seqlock
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define SEQLOCK
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      integer_set_seqlock
+#define KEY_TY    uint64_t
+#define SEQLOCK
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+// Tables supporting parallel functions.
+// Only the calling thread allocates memory, so the tables can use the (non-thread-safe) tracking allocator.
+
+#define NAME      parallel_integer_map
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define PARALLEL
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      parallel_integer_set
+#define KEY_TY    uint64_t
+#define PARALLEL
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+// Identity hash function, used to place keys in predictable buckets.
+// Because the high bits of the hash codes of small keys are all zero, all such keys also share a hash-code fragment.
+
+uint64_t identity_hash( uint64_t key )
+{
+  return key;
+}
+
+#define NAME      integer_map_with_identity_hash
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define HASH_FN   identity_hash
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      integer_set_with_identity_hash
+#define KEY_TY    uint64_t
+#define HASH_FN   identity_hash
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+// Table whose large values are stored apart from the keys.
+
+typedef struct
+{
+  uint64_t n;
+  char padding[ 192 ];
+} large_val;
+
+#define NAME      integer_map_with_separate_values
+#define KEY_TY    uint64_t
+#define VAL_TY    large_val
+#define SEPARATE_VALUES
+#define INCREMENTAL_REHASH
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      integer_map_with_metadata_32
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define HASH_FN   identity_hash
+#define METADATA_32
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      integer_set_with_metadata_32
+#define KEY_TY    uint64_t
+#define HASH_FN   identity_hash
+#define METADATA_32
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      integer_map_ordered
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define ORDERED
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      integer_set_ordered
+#define KEY_TY    uint64_t
+#define ORDERED
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      parallel_integer_map_with_identity_hash
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define HASH_FN   identity_hash
+#define PARALLEL
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      parallel_integer_set_with_identity_hash
+#define KEY_TY    uint64_t
+#define HASH_FN   identity_hash
+#define PARALLEL
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+// Tables supporting saving and loading.
+// The map also rehashes incrementally to check that a loaded buckets array is never retained as the old buckets array.
+// The other tables are identical to the map or set except for the hash function or HASH_FN_ID, so they must reject
+// files saved by the map or set.
+
+#define NAME      serialized_integer_map
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define SERIALIZATION
+#define INCREMENTAL_REHASH
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      serialized_integer_map_with_identity_hash
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define HASH_FN   identity_hash
+#define SERIALIZATION
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME      serialized_integer_set
+#define KEY_TY    uint64_t
+#define SERIALIZATION
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+#define NAME       serialized_integer_set_with_hash_fn_id
+#define KEY_TY     uint64_t
+#define SERIALIZATION
+#define HASH_FN_ID 1
+#define MAX_LOAD   GLOBAL_MAX_LOAD
+#define MALLOC_FN  unreliable_tracking_malloc
+#define FREE_FN    tracking_free
+#include "../verstable.h"
+
+// A table combining the parallel functions with saving and loading, whose prototypes are declared side by side.
+
+#define NAME      parallel_serialized_integer_map
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define PARALLEL
+#define SERIALIZATION
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#include "../verstable.h"
+
+// Tables using the huge-page allocator, which relies on MALLOC_FN_ZEROES to skip zeroing the metadata.
+
+#define NAME      huge_page_integer_map
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define CTX_TY    vt_huge_page_ctx
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN vt_huge_page_malloc
+#define FREE_FN   vt_huge_page_free
+#define MALLOC_FN_ZEROES
+#include "../verstable.h"
+
+#define NAME      huge_page_integer_set
+#define KEY_TY    uint64_t
+#define CTX_TY    vt_huge_page_ctx
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN vt_huge_page_malloc
+#define FREE_FN   vt_huge_page_free
+#define MALLOC_FN_ZEROES
+#include "../verstable.h"
+
+// Tables of NULL-terminated strings that can be looked up via (pointer, length) slices.
+
+typedef struct
+{
+  const char *ptr;
+  size_t len;
+} string_slice;
+
+// Same as vt_hash_string.
+uint64_t hash_string_slice( string_slice key )
+{
+  return vt_hash_bytes( key.ptr, key.len );
+}
+
+bool cmpr_string_slice( char *key_in_table, string_slice key )
+{
+  return strncmp( key_in_table, key.ptr, key.len ) == 0 && key_in_table[ key.len ] == '\0';
+}
+
+#define NAME           string_map_with_lookup
+#define KEY_TY         char *
+#define VAL_TY         size_t
+#define LOOKUP_KEY_TY  string_slice
+#define LOOKUP_HASH_FN hash_string_slice
+#define LOOKUP_CMPR_FN cmpr_string_slice
+#define STORE_HASH
+#define INCREMENTAL_REHASH
+#define MAX_LOAD       GLOBAL_MAX_LOAD
+#define MALLOC_FN      unreliable_tracking_malloc
+#define FREE_FN        tracking_free
+#include "../verstable.h"
+
+#define NAME           string_set_with_lookup
+#define KEY_TY         char *
+#define LOOKUP_KEY_TY  string_slice
+#define LOOKUP_HASH_FN hash_string_slice
+#define LOOKUP_CMPR_FN cmpr_string_slice
+#define MAX_LOAD       GLOBAL_MAX_LOAD
+#define MALLOC_FN      unreliable_tracking_malloc
+#define FREE_FN        tracking_free
+#include "../verstable.h"
+
+// Tables of small-string-optimized strings, whose hash and comparison functions are inferred.
+
+#define NAME        sso_string_map
+#define KEY_TY      vt_sso_string
+#define VAL_TY      size_t
+#define KEY_DTOR_FN vt_sso_string_free
+#define MAX_LOAD    GLOBAL_MAX_LOAD
+#define MALLOC_FN   unreliable_tracking_malloc
+#define FREE_FN     tracking_free
+#include "../verstable.h"
+
+#define NAME        sso_string_set
+#define KEY_TY      vt_sso_string
+#define KEY_DTOR_FN vt_sso_string_free
+#define MAX_LOAD    GLOBAL_MAX_LOAD
+#define MALLOC_FN   unreliable_tracking_malloc
+#define FREE_FN     tracking_free
+#include "../verstable.h"
+
+// A table instantiated in HEADER_MODE, as in a header shared by several translation units.
+// Its functions are only defined by the IMPLEMENTATION_MODE instantiation at the end of this file, so the tests below
+// compile against its prototypes alone.
+
+#define NAME   header_mode_integer_map
+#define KEY_TY uint64_t
+#define VAL_TY uint64_t
+#define SERIALIZATION
+#define HEADER_MODE
+#include "../verstable.h"
+
+// Writes a string of i % 30 dashes followed by i's digits (so that long strings share their prefixes), returning its
+// length.
+size_t write_padded_key( char *buffer, size_t i )
+{
+  size_t len = i % 30;
+  memset( buffer, '-', len );
+  return len + (size_t)sprintf( buffer + len, "%zu", i );
+}
+
 // Unit tests.
 
+void test_hash_bytes( void )
+{
+  unsigned char bytes[ 300 ] = { 0 };
+
+  // Test that the hash depends on the length, even when the additional bytes are zero, and not on the alignment.
+  uint64_t hashes[ 257 ];
+  for( size_t i = 0; i <= 256; ++i )
+  {
+    hashes[ i ] = vt_hash_bytes( bytes, i );
+    for( size_t j = 0; j < i; ++j )
+      ALWAYS_ASSERT( hashes[ i ] != hashes[ j ] );
+
+    ALWAYS_ASSERT( vt_hash_bytes( bytes + 1 + i % 7, i ) == hashes[ i ] );
+  }
+
+  // Test that the string hash functions agree with vt_hash_bytes.
+  char str[] = "a string longer than VT_SSO_STRING_CAPACITY";
+  vt_sso_string sso_str;
+  ALWAYS_ASSERT( vt_sso_string_borrow( &sso_str, str, strlen( str ) ) );
+  ALWAYS_ASSERT( vt_hash_string( str ) == vt_hash_bytes( str, strlen( str ) ) );
+  ALWAYS_ASSERT( vt_hash_sso_string( sso_str ) == vt_hash_string( str ) );
+
+  // Test that the four high bits, which form the hash-code fragment, are evenly distributed across keys that differ
+  // only slightly, i.e. consecutive decimal strings and consecutive integers' bytes.
+  // The expected count per fragment value is 256, with a standard deviation of about 16.
+  size_t string_counts[ 16 ] = { 0 };
+  size_t integer_counts[ 16 ] = { 0 };
+  for( uint64_t i = 0; i < 4096; ++i )
+  {
+    char buffer[ 32 ];
+    ++string_counts[ vt_hash_bytes( buffer, (size_t)sprintf( buffer, "%llu", (unsigned long long)i ) ) >> 60 ];
+    ++integer_counts[ vt_hash_bytes( &i, sizeof( i ) ) >> 60 ];
+  }
+
+  for( int i = 0; i < 16; ++i )
+    ALWAYS_ASSERT(
+      string_counts[ i ] > 256 - 80 && string_counts[ i ] < 256 + 80 &&
+      integer_counts[ i ] > 256 - 80 && integer_counts[ i ] < 256 + 80
+    );
+
+  // Test that flipping any one input bit flips each of the four high bits about half of the time (avalanche).
+  // For each bit, the expected count is 8192 out of 16384 flips, with a standard deviation of 64.
+  size_t flip_counts[ 4 ] = { 0 };
+  for( size_t i = 0; i < 64; ++i )
+  {
+    for( size_t j = 0; j < 32; ++j )
+      bytes[ j ] = (unsigned char)vt_hash_integer( i * 32 + j );
+
+    uint64_t hash = vt_hash_bytes( bytes, 32 );
+    for( size_t bit = 0; bit < 256; ++bit )
+    {
+      bytes[ bit / 8 ] ^= (unsigned char)( 1 << bit % 8 );
+      uint64_t flipped_hash = vt_hash_bytes( bytes, 32 );
+      bytes[ bit / 8 ] ^= (unsigned char)( 1 << bit % 8 );
+
+      for( int k = 0; k < 4; ++k )
+        flip_counts[ k ] += ( ( hash ^ flipped_hash ) >> ( 60 + k ) ) & 1;
+    }
+  }
+
+  for( int k = 0; k < 4; ++k )
+    ALWAYS_ASSERT( flip_counts[ k ] > 8192 - 400 && flip_counts[ k ] < 8192 + 400 );
+}
+
 void test_map_reserve( void )
 {
   integer_map our_map;
@@ -351,45 +792,409 @@ void test_map_get_or_insert( void )
   vt_cleanup( &our_map );
 }
 
-void test_map_get( void )
+void test_map_emplace( void )
 {
   integer_map our_map;
   vt_init( &our_map );
 
-  // Test empty.
-  for( uint64_t i = 0; i < 100; ++i )
-    ALWAYS_ASSERT( vt_is_end( vt_get( &our_map, i ) ) );
-
-  // Test get existing.
+  // Test insert, constructing each value in place.
   for( uint64_t i = 0; i < 100; ++i )
-    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+  {
+    integer_map_itr itr;
+    bool inserted = false;
+    UNTIL_SUCCESS( !vt_is_end( itr = integer_map_emplace( &our_map, i, &inserted ) ) );
+    ALWAYS_ASSERT( inserted && itr.data->key == i );
+    itr.data->val = i + 1;
+  }
 
+  ALWAYS_ASSERT( vt_size( &our_map ) == 100 );
   for( uint64_t i = 0; i < 100; ++i )
   {
     integer_map_itr itr = vt_get( &our_map, i );
     ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == i + 1 );
   }
 
-  // Test get non-existing.
-  for( uint64_t i = 100; i < 200; ++i )
-    ALWAYS_ASSERT( vt_is_end( vt_get( &our_map, i ) ) );
-
-  vt_cleanup( &our_map );
-}
-
-void test_map_erase( void )
-{
-  integer_map our_map;
-  vt_init( &our_map );
-
-  // Test erase existing.
+  // Test get.
   for( uint64_t i = 0; i < 100; ++i )
-    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+  {
+    integer_map_itr itr_1 = vt_get( &our_map, i );
+    integer_map_itr itr_2;
+    bool inserted = true;
+    UNTIL_SUCCESS( !vt_is_end( itr_2 = integer_map_emplace( &our_map, i, &inserted ) ) );
+    ALWAYS_ASSERT( !inserted && itr_2.data == itr_1.data && itr_2.data->val == i + 1 );
+  }
 
   ALWAYS_ASSERT( vt_size( &our_map ) == 100 );
 
-  for( uint64_t i = 0; i < 100; i += 2 )
-    ALWAYS_ASSERT( vt_erase( &our_map, i ) );
+  // Test values stored apart from their keys, which are constructed via the iterator's val member.
+  integer_map_with_separate_values separate_map;
+  vt_init( &separate_map );
+
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    integer_map_with_separate_values_itr itr;
+    bool inserted = false;
+    UNTIL_SUCCESS( !vt_is_end( itr = integer_map_with_separate_values_emplace( &separate_map, i, &inserted ) ) );
+    ALWAYS_ASSERT( inserted );
+    itr.val->n = i + 1;
+  }
+
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    integer_map_with_separate_values_itr itr = vt_get( &separate_map, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.val->n == i + 1 );
+  }
+
+  vt_cleanup( &separate_map );
+  vt_cleanup( &our_map );
+}
+
+// Constructors for NAME_get_or_insert_lazy that count their calls and fail for odd keys.
+
+bool construct_even_val( uint64_t *key, uint64_t *val, void *user )
+{
+  ++*(size_t *)user;
+  if( *key % 2 )
+    return false;
+
+  *val = *key + 1;
+  return true;
+}
+
+// Replaces the borrowed key with an owned copy.
+bool construct_string_val( char **key, char **val, void *user )
+{
+  (void)user;
+  char *copy = (char *)malloc( strlen( *key ) + 1 );
+  if( !copy )
+    return false;
+
+  strcpy( copy, *key );
+  *key = copy;
+  *val = (char *)"constructed";
+  return true;
+}
+
+void test_map_get_or_insert_lazy( void )
+{
+  integer_dtors_map our_map;
+  vt_init( &our_map );
+
+  size_t ctor_calls = 0;
+
+  // Test insert, with failed constructions leaving the table unchanged and calling no destructors.
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_dtors_map_itr itr;
+    if( i % 2 )
+    {
+      itr = integer_dtors_map_get_or_insert_lazy( &our_map, i, construct_even_val, &ctor_calls );
+      ALWAYS_ASSERT( vt_is_end( itr ) );
+      ALWAYS_ASSERT( vt_size( &our_map ) == i / 2 + 1 );
+      continue;
+    }
+
+    UNTIL_SUCCESS(
+      !vt_is_end( itr = integer_dtors_map_get_or_insert_lazy( &our_map, i, construct_even_val, &ctor_calls ) )
+    );
+    ALWAYS_ASSERT( itr.data->key == i && itr.data->val == i + 1 );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_map ) == 50 );
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    ALWAYS_ASSERT( !dtor_called[ i ] );
+    integer_dtors_map_itr itr = vt_get( &our_map, i );
+    ALWAYS_ASSERT( i % 2 ? vt_is_end( itr ) : !vt_is_end( itr ) && itr.data->val == i + 1 );
+  }
+
+  // Test get, which must not call the constructor.
+  size_t ctor_calls_before_get = ctor_calls;
+  for( uint64_t i = 0; i < 100; i += 2 )
+  {
+    integer_dtors_map_itr itr_1 = vt_get( &our_map, i );
+    integer_dtors_map_itr itr_2 = integer_dtors_map_get_or_insert_lazy( &our_map, i, construct_even_val, &ctor_calls );
+    ALWAYS_ASSERT( itr_2.data == itr_1.data && itr_2.data->val == i + 1 );
+  }
+
+  ALWAYS_ASSERT( ctor_calls == ctor_calls_before_get );
+  ALWAYS_ASSERT( vt_size( &our_map ) == 50 );
+
+  vt_cleanup( &our_map );
+  check_dtors_arr();
+
+  // Test that failed constructions leave no trace in the insertion order.
+  integer_map_ordered ordered_map;
+  vt_init( &ordered_map );
+
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    if( i % 2 )
+      integer_map_ordered_get_or_insert_lazy( &ordered_map, i, construct_even_val, &ctor_calls );
+    else
+      UNTIL_SUCCESS(
+        !vt_is_end( integer_map_ordered_get_or_insert_lazy( &ordered_map, i, construct_even_val, &ctor_calls ) )
+      );
+  }
+
+  ALWAYS_ASSERT( vt_size( &ordered_map ) == 50 );
+  uint64_t expected = 0;
+  for( integer_map_ordered_itr itr = vt_first( &ordered_map ); !vt_is_end( itr ); itr = vt_next( itr ) )
+  {
+    ALWAYS_ASSERT( itr.data->key == expected && itr.data->val == expected + 1 );
+    expected += 2;
+  }
+
+  ALWAYS_ASSERT( expected == 100 );
+  vt_cleanup( &ordered_map );
+
+  // Test replacing a borrowed key with an owned copy.
+  string_map strings;
+  vt_init( &strings );
+
+  char buffer[ 16 ];
+  for( int i = 0; i < 100; ++i )
+  {
+    sprintf( buffer, "%d", i );
+    string_map_itr itr;
+    UNTIL_SUCCESS( !vt_is_end( itr = string_map_get_or_insert_lazy( &strings, buffer, construct_string_val, NULL ) ) );
+    ALWAYS_ASSERT( itr.data->key != buffer && strcmp( itr.data->key, buffer ) == 0 );
+  }
+
+  strcpy( buffer, "overwritten" );
+  ALWAYS_ASSERT( vt_size( &strings ) == 100 );
+  for( int i = 0; i < 100; ++i )
+  {
+    sprintf( buffer, "%d", i );
+    string_map_itr itr = vt_get( &strings, buffer );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && strcmp( itr.data->val, "constructed" ) == 0 );
+  }
+
+  for( string_map_itr itr = vt_first( &strings ); !vt_is_end( itr ); itr = vt_next( itr ) )
+    free( itr.data->key );
+
+  vt_cleanup( &strings );
+}
+
+void test_map_get( void )
+{
+  integer_map our_map;
+  vt_init( &our_map );
+
+  // Test empty.
+  for( uint64_t i = 0; i < 100; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_map, i ) ) );
+
+  // Test get existing.
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_map_itr itr = vt_get( &our_map, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == i + 1 );
+  }
+
+  // Test get non-existing.
+  for( uint64_t i = 100; i < 200; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_map, i ) ) );
+
+  vt_cleanup( &our_map );
+}
+
+void test_map_get_batch( void )
+{
+  integer_map our_map;
+  vt_init( &our_map );
+
+  // The batch size is chosen to exceed VT_PREFETCH_DISTANCE so that the prefetch pipeline wraps around.
+  uint64_t keys[ 200 ];
+  integer_map_itr itrs[ 200 ];
+  for( uint64_t i = 0; i < 200; ++i )
+    keys[ i ] = i;
+
+  // Test empty.
+  vt_get_batch( &our_map, keys, 200, itrs );
+  for( uint64_t i = 0; i < 200; ++i )
+    ALWAYS_ASSERT( vt_is_end( itrs[ i ] ) );
+
+  // Test zero keys.
+  vt_get_batch( &our_map, keys, 0, itrs );
+
+  // Test mix of existing and non-existing.
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+
+  vt_get_batch( &our_map, keys, 200, itrs );
+  for( uint64_t i = 0; i < 200; ++i )
+  {
+    if( i < 100 )
+      ALWAYS_ASSERT( !vt_is_end( itrs[ i ] ) && itrs[ i ].data->key == i && itrs[ i ].data->val == i + 1 );
+    else
+      ALWAYS_ASSERT( vt_is_end( itrs[ i ] ) );
+  }
+
+  // Test fewer keys than the prefetch distance.
+  vt_get_batch( &our_map, keys + 95, 10, itrs );
+  for( uint64_t i = 0; i < 10; ++i )
+  {
+    if( i < 5 )
+      ALWAYS_ASSERT( !vt_is_end( itrs[ i ] ) && itrs[ i ].data->val == i + 96 );
+    else
+      ALWAYS_ASSERT( vt_is_end( itrs[ i ] ) );
+  }
+
+  vt_cleanup( &our_map );
+}
+
+void test_map_insert_n( void )
+{
+  integer_map our_map;
+  vt_init( &our_map );
+
+  // The batch contains each key in 0-299 twice, interleaved, so that the second occurrence's value must win as it
+  // would in a loop of vt_insert calls.
+  uint64_t keys[ 600 ];
+  uint64_t vals[ 600 ];
+  for( uint64_t i = 0; i < 600; ++i )
+  {
+    keys[ i ] = i % 300;
+    vals[ i ] = i + 1;
+  }
+
+  // Test zero keys.
+  ALWAYS_ASSERT( vt_insert_n( &our_map, keys, vals, 0 ) == 0 );
+  ALWAYS_ASSERT( vt_size( &our_map ) == 0 );
+
+  // Test insert new and duplicates within the batch.
+  // In the case of allocation failure, resume from the first key not inserted.
+  for( size_t inserted = 0; inserted < 600; )
+    inserted += vt_insert_n( &our_map, keys + inserted, vals + inserted, 600 - inserted );
+
+  ALWAYS_ASSERT( vt_size( &our_map ) == 300 );
+  for( uint64_t i = 0; i < 300; ++i )
+  {
+    integer_map_itr itr = vt_get( &our_map, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == i + 301 );
+  }
+
+  // Test replace existing (fewer keys than the prefetch distance).
+  for( size_t inserted = 0; inserted < 10; )
+    inserted += vt_insert_n( &our_map, keys + inserted, keys + inserted, 10 - inserted );
+
+  ALWAYS_ASSERT( vt_size( &our_map ) == 300 );
+  for( uint64_t i = 0; i < 300; ++i )
+    ALWAYS_ASSERT( vt_get( &our_map, i ).data->val == ( i < 10 ? i : i + 301 ) );
+
+  vt_cleanup( &our_map );
+}
+
+void test_map_erase_n( void )
+{
+  integer_map our_map;
+  vt_init( &our_map );
+
+  // The batch contains each key in 50-199 twice, interleaved.
+  uint64_t keys[ 300 ];
+  for( uint64_t i = 0; i < 300; ++i )
+    keys[ i ] = 50 + i % 150;
+
+  // Test empty.
+  ALWAYS_ASSERT( vt_erase_n( &our_map, keys, 300 ) == 0 );
+
+  for( uint64_t i = 0; i < 150; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+
+  // Test zero keys.
+  ALWAYS_ASSERT( vt_erase_n( &our_map, keys, 0 ) == 0 );
+
+  // Test mix of existing, non-existing, and duplicates within the batch (only the first occurrence of each key is
+  // erased).
+  ALWAYS_ASSERT( vt_erase_n( &our_map, keys, 300 ) == 100 );
+  ALWAYS_ASSERT( vt_size( &our_map ) == 50 );
+  for( uint64_t i = 0; i < 150; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_map, i ) ) == ( i >= 50 ) );
+
+  // Test fewer keys than the prefetch distance.
+  uint64_t few_keys[ 10 ];
+  for( uint64_t i = 0; i < 10; ++i )
+    few_keys[ i ] = i + 45;
+
+  ALWAYS_ASSERT( vt_erase_n( &our_map, few_keys, 10 ) == 5 );
+  ALWAYS_ASSERT( vt_size( &our_map ) == 45 );
+
+  vt_cleanup( &our_map );
+}
+
+void test_map_with_hash( void )
+{
+  integer_map our_map;
+  vt_init( &our_map );
+
+  // Insert new.
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_map_itr itr;
+    UNTIL_SUCCESS( !vt_is_end( itr = vt_insert_with_hash( &our_map, i, i + 1, vt_hash_integer( i ) ) ) );
+    ALWAYS_ASSERT( itr.data->key == i && itr.data->val == i + 1 );
+  }
+
+  // Insert existing.
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_map_itr itr;
+    UNTIL_SUCCESS( !vt_is_end( itr = vt_insert_with_hash( &our_map, i, i + 2, vt_hash_integer( i ) ) ) );
+    ALWAYS_ASSERT( itr.data->val == i + 2 );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_map ) == 100 );
+
+  // Get or insert.
+  for( uint64_t i = 0; i < 200; ++i )
+  {
+    integer_map_itr itr;
+    UNTIL_SUCCESS( !vt_is_end( itr = vt_get_or_insert_with_hash( &our_map, i, i + 3, vt_hash_integer( i ) ) ) );
+    ALWAYS_ASSERT( itr.data->val == ( i < 100 ? i + 2 : i + 3 ) );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_map ) == 200 );
+
+  // Erase.
+  for( uint64_t i = 0; i < 200; i += 2 )
+    ALWAYS_ASSERT( vt_erase_with_hash( &our_map, i, vt_hash_integer( i ) ) );
+
+  for( uint64_t i = 0; i < 200; i += 2 )
+    ALWAYS_ASSERT( !vt_erase_with_hash( &our_map, i, vt_hash_integer( i ) ) );
+
+  // Check, using both the hash and non-hash lookup functions.
+  ALWAYS_ASSERT( vt_size( &our_map ) == 100 );
+  for( uint64_t i = 0; i < 200; ++i )
+  {
+    integer_map_itr itr_1 = vt_get_with_hash( &our_map, i, vt_hash_integer( i ) );
+    integer_map_itr itr_2 = vt_get( &our_map, i );
+    ALWAYS_ASSERT( itr_1.data == itr_2.data );
+    if( i % 2 == 0 )
+      ALWAYS_ASSERT( vt_is_end( itr_1 ) );
+    else
+      ALWAYS_ASSERT( !vt_is_end( itr_1 ) && itr_1.data->val == ( i < 100 ? i + 2 : i + 3 ) );
+  }
+
+  vt_cleanup( &our_map );
+}
+
+void test_map_erase( void )
+{
+  integer_map our_map;
+  vt_init( &our_map );
+
+  // Test erase existing.
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+
+  ALWAYS_ASSERT( vt_size( &our_map ) == 100 );
+
+  for( uint64_t i = 0; i < 100; i += 2 )
+    ALWAYS_ASSERT( vt_erase( &our_map, i ) );
 
   // Test erase non-existing.
   for( uint64_t i = 0; i < 100; i += 2 )
@@ -470,6 +1275,142 @@ void test_map_erase_itr( void )
   vt_cleanup( &our_map );
 }
 
+// Predicate for NAME_erase_if that selects keys divisible by the divisor pointed to by ctx.
+bool key_is_multiple( uint64_t *key, uint64_t *val, void *ctx )
+{
+  (void)val;
+  return *key % *(uint64_t *)ctx == 0;
+}
+
+void test_map_erase_if( void )
+{
+  integer_map our_map;
+  vt_init( &our_map );
+
+  // Test empty.
+  uint64_t divisor = 2;
+  ALWAYS_ASSERT( vt_erase_if( &our_map, key_is_multiple, &divisor ) == 0 );
+
+  // Erase keys divisible by 2, 3, and 5 in turn, checking after each sweep that the chains remain intact by finding
+  // every surviving key and then reinserting the erased keys.
+  for( uint64_t i = 0; i < 3000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+
+  uint64_t divisors[] = { 2, 3, 5 };
+  for( size_t d = 0; d < 3; ++d )
+  {
+    ALWAYS_ASSERT( vt_erase_if( &our_map, key_is_multiple, &divisors[ d ] ) == 3000 / divisors[ d ] );
+    ALWAYS_ASSERT( vt_size( &our_map ) == 3000 - 3000 / divisors[ d ] );
+
+    for( uint64_t i = 0; i < 3000; ++i )
+    {
+      integer_map_itr itr = vt_get( &our_map, i );
+      if( i % divisors[ d ] == 0 )
+        ALWAYS_ASSERT( vt_is_end( itr ) );
+      else
+        ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == i + 1 );
+    }
+
+    for( uint64_t i = 0; i < 3000; i += divisors[ d ] )
+      UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+
+    ALWAYS_ASSERT( vt_size( &our_map ) == 3000 );
+  }
+
+  // Test erasing all keys.
+  divisor = 1;
+  ALWAYS_ASSERT( vt_erase_if( &our_map, key_is_multiple, &divisor ) == 3000 );
+  ALWAYS_ASSERT( vt_size( &our_map ) == 0 && vt_is_end( vt_first( &our_map ) ) );
+
+  vt_cleanup( &our_map );
+
+  // Test that the destructors are called on exactly the erased keys and values.
+  integer_dtors_map dtors_map;
+  vt_init( &dtors_map );
+
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &dtors_map, i, i ) ) );
+
+  divisor = 2;
+  ALWAYS_ASSERT( vt_erase_if( &dtors_map, key_is_multiple, &divisor ) == 50 );
+  for( uint64_t i = 0; i < 100; ++i )
+    ALWAYS_ASSERT( dtor_called[ i ] == ( i % 2 == 0 ) );
+
+  vt_cleanup( &dtors_map );
+  check_dtors_arr();
+
+  // Test 32-bit metadata, which are scanned two rather than four at a time.
+  integer_map_with_metadata_32 map_32;
+  vt_init( &map_32 );
+
+  for( uint64_t i = 0; i < 3000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &map_32, i, i + 1 ) ) );
+
+  divisor = 3;
+  ALWAYS_ASSERT( vt_erase_if( &map_32, key_is_multiple, &divisor ) == 1000 );
+  for( uint64_t i = 0; i < 3000; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &map_32, i ) ) == ( i % 3 == 0 ) );
+
+  vt_cleanup( &map_32 );
+
+  // Test that the insertion order of the surviving keys is preserved.
+  integer_map_ordered ordered_map;
+  vt_init( &ordered_map );
+
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &ordered_map, 999 - i, i ) ) );
+
+  divisor = 3;
+  ALWAYS_ASSERT( vt_erase_if( &ordered_map, key_is_multiple, &divisor ) == 334 );
+
+  uint64_t expected = 999;
+  for( integer_map_ordered_itr itr = vt_first( &ordered_map ); !vt_is_end( itr ); itr = vt_next( itr ) )
+  {
+    while( expected % 3 == 0 )
+      --expected;
+
+    ALWAYS_ASSERT( itr.data->key == expected && vt_get( &ordered_map, expected ).data == itr.data );
+    --expected;
+  }
+
+  ALWAYS_ASSERT( expected == 0 );
+  vt_cleanup( &ordered_map );
+
+  // Test erasing from both buckets arrays during an incremental rehash.
+  integer_map_incremental incremental_map;
+  vt_init( &incremental_map );
+
+  uint64_t n = 0;
+  while( incremental_map.old_buckets_mask < 255 )
+  {
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &incremental_map, n, n + 1 ) ) );
+    ++n;
+  }
+
+  divisor = 2;
+  ALWAYS_ASSERT( vt_erase_if( &incremental_map, key_is_multiple, &divisor ) == ( n + 1 ) / 2 );
+  ALWAYS_ASSERT( vt_size( &incremental_map ) == n / 2 );
+  for( uint64_t i = 0; i < n; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &incremental_map, i ) ) == ( i % 2 == 0 ) );
+
+  vt_cleanup( &incremental_map );
+
+  // Test the concurrent variant.
+  shard_integer_map_concurrent shard_map;
+  ALWAYS_ASSERT( shard_integer_map_concurrent_init( &shard_map ) );
+
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( shard_integer_map_concurrent_insert( &shard_map, i, i + 1 ) );
+
+  divisor = 4;
+  ALWAYS_ASSERT( shard_integer_map_concurrent_erase_if( &shard_map, key_is_multiple, &divisor ) == 250 );
+  ALWAYS_ASSERT( shard_integer_map_concurrent_size( &shard_map ) == 750 );
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( shard_integer_map_concurrent_get( &shard_map, i, NULL ) == ( i % 4 != 0 ) );
+
+  shard_integer_map_concurrent_cleanup( &shard_map );
+}
+
 void test_map_clear( void )
 {
   integer_map our_map;
@@ -560,10 +1501,113 @@ void test_map_init_clone( void )
   vt_cleanup( &our_map );
 }
 
-void test_map_iteration( void )
+void test_map_set_operations( void )
 {
-  integer_map our_map;
-  vt_init( &our_map );
+  // a contains keys 0 to 999 with values key + 1, and b contains keys 500 to 1999 with values key + 2.
+  integer_map a;
+  integer_map b;
+  vt_init( &a );
+  vt_init( &b );
+
+  // Test empty.
+  integer_map out;
+  vt_init( &out );
+  UNTIL_SUCCESS( vt_intersect( &out, &a, &b ) );
+  UNTIL_SUCCESS( vt_union_into( &out, &a ) );
+  UNTIL_SUCCESS( vt_difference( &out, &a, &b ) );
+  ALWAYS_ASSERT( vt_size( &out ) == 0 );
+
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &a, i, i + 1 ) ) );
+
+  for( uint64_t i = 500; i < 2000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &b, i, i + 2 ) ) );
+
+  // Test intersect, iterating over a and then over b, with the values always taken from the first table.
+  UNTIL_SUCCESS( vt_intersect( &out, &a, &b ) );
+  ALWAYS_ASSERT( vt_size( &out ) == 500 );
+  for( uint64_t i = 0; i < 2000; ++i )
+  {
+    integer_map_itr itr = vt_get( &out, i );
+    ALWAYS_ASSERT( i >= 500 && i < 1000 ? !vt_is_end( itr ) && itr.data->val == i + 1 : vt_is_end( itr ) );
+  }
+
+  vt_clear( &out );
+  UNTIL_SUCCESS( vt_intersect( &out, &b, &a ) );
+  ALWAYS_ASSERT( vt_size( &out ) == 500 );
+  for( uint64_t i = 500; i < 1000; ++i )
+    ALWAYS_ASSERT( vt_get( &out, i ).data->val == i + 2 );
+
+  // Test difference.
+  vt_clear( &out );
+  UNTIL_SUCCESS( vt_difference( &out, &a, &b ) );
+  ALWAYS_ASSERT( vt_size( &out ) == 500 );
+  for( uint64_t i = 0; i < 2000; ++i )
+  {
+    integer_map_itr itr = vt_get( &out, i );
+    ALWAYS_ASSERT( i < 500 ? !vt_is_end( itr ) && itr.data->val == i + 1 : vt_is_end( itr ) );
+  }
+
+  // Test union_into, which must not replace the keys already in out.
+  vt_clear( &out );
+  UNTIL_SUCCESS( vt_union_into( &out, &b ) );
+  UNTIL_SUCCESS( vt_union_into( &out, &a ) );
+  ALWAYS_ASSERT( vt_size( &out ) == 2000 );
+  for( uint64_t i = 0; i < 2000; ++i )
+    ALWAYS_ASSERT( vt_get( &out, i ).data->val == ( i < 500 ? i + 1 : i + 2 ) );
+
+  vt_cleanup( &out );
+  vt_cleanup( &b );
+  vt_cleanup( &a );
+
+  // Test that stored hash codes are reused rather than recomputed.
+  integer_map_with_stored_hash stored_a;
+  integer_map_with_stored_hash stored_b;
+  integer_map_with_stored_hash stored_out;
+  vt_init( &stored_a );
+  vt_init( &stored_b );
+  vt_init( &stored_out );
+
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &stored_a, i, i + 1 ) ) );
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &stored_b, i * 2, i ) ) );
+  }
+
+  hash_calls = 0;
+  UNTIL_SUCCESS( vt_intersect( &stored_out, &stored_a, &stored_b ) );
+  ALWAYS_ASSERT( vt_size( &stored_out ) == 500 && hash_calls == 0 );
+
+  vt_cleanup( &stored_out );
+  vt_cleanup( &stored_b );
+  vt_cleanup( &stored_a );
+
+  // Test values stored apart from their keys.
+  integer_map_with_separate_values separate_a;
+  integer_map_with_separate_values separate_out;
+  vt_init( &separate_a );
+  vt_init( &separate_out );
+
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    integer_map_with_separate_values_itr itr;
+    UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &separate_a, i, ( large_val ){ 0 } ) ) );
+    itr.val->n = i + 1;
+  }
+
+  UNTIL_SUCCESS( vt_union_into( &separate_out, &separate_a ) );
+  ALWAYS_ASSERT( vt_size( &separate_out ) == 1000 );
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( vt_get( &separate_out, i ).val->n == i + 1 );
+
+  vt_cleanup( &separate_out );
+  vt_cleanup( &separate_a );
+}
+
+void test_map_iteration( void )
+{
+  integer_map our_map;
+  vt_init( &our_map );
 
   // Empty.
 
@@ -597,6 +1641,104 @@ void test_map_iteration( void )
   vt_cleanup( &our_map );
 }
 
+// Returns the index of the first non-zero element among the width elements beginning at metadata, or width if all are
+// zero, i.e. the result that vt_first_nonzero_metadatum and vt_first_nonzero_metadatum_32 should return.
+int first_nonzero_reference( const void *metadata, size_t metadatum_size, int width )
+{
+  for( int i = 0; i < width; ++i )
+  {
+    uint32_t metadatum = 0;
+    memcpy( &metadatum, (const unsigned char *)metadata + i * metadatum_size, metadatum_size );
+    if( metadatum )
+      return i;
+  }
+
+  return width;
+}
+
+// Tests the metadata scan that iteration uses to skip empty buckets (SSE2 unless VT_NO_SIMD is defined or SSE2 is
+// unavailable) against a scalar reference, and then iteration over sparse tables whose keys lie near the end of the
+// buckets array, where the scan reaches the excess metadata.
+// Compile the tests with and without -DVT_NO_SIMD to cover both scans.
+void test_map_sparse_iteration( void )
+{
+  static const uint32_t nonzero_vals[] = { 0x1, 0x800, 0x8000, 0xFFFF, 0x80000000u, 0xFFFFFFFFu };
+
+  for( size_t v = 0; v < sizeof( nonzero_vals ) / sizeof( *nonzero_vals ); ++v )
+    for( int nonzero = -1; nonzero < 48; ++nonzero )
+    {
+      uint16_t metadata[ 48 + VT_METADATA_EXCESS ] = { 0 };
+      uint32_t metadata_32[ 48 + VT_METADATA_EXCESS ] = { 0 };
+      if( nonzero >= 0 )
+      {
+        metadata[ nonzero ] = (uint16_t)nonzero_vals[ v ] ? (uint16_t)nonzero_vals[ v ] : 0x8000;
+        metadata_32[ nonzero ] = nonzero_vals[ v ];
+      }
+
+      for( int begin = 0; begin < 48; ++begin )
+      {
+        ALWAYS_ASSERT(
+          vt_first_nonzero_metadatum( metadata + begin ) ==
+          first_nonzero_reference( metadata + begin, sizeof( uint16_t ), VT_METADATA_SCAN_WIDTH )
+        );
+        ALWAYS_ASSERT(
+          vt_first_nonzero_metadatum_32( metadata_32 + begin ) ==
+          first_nonzero_reference( metadata_32 + begin, sizeof( uint32_t ), VT_METADATA_SCAN_WIDTH_32 )
+        );
+      }
+    }
+
+  // With the identity hash function, each key below the bucket count lies in its home bucket, i.e. the bucket whose
+  // index is the key, and iteration visits the keys in ascending order.
+  integer_map_with_identity_hash our_map;
+  vt_init( &our_map );
+  integer_map_with_metadata_32 our_map_32;
+  vt_init( &our_map_32 );
+
+  UNTIL_SUCCESS( vt_reserve( &our_map, 100 ) );
+  UNTIL_SUCCESS( vt_reserve( &our_map_32, 100 ) );
+  uint64_t bucket_count = vt_bucket_count( &our_map );
+  ALWAYS_ASSERT( vt_bucket_count( &our_map_32 ) == bucket_count );
+
+  // One or two keys, the last of which lies within 24 buckets of the end.
+  for( uint64_t last = bucket_count - 24; last < bucket_count; ++last )
+    for( uint64_t gap = 0; gap <= 24; ++gap )
+    {
+      uint64_t first = last - gap;
+
+      UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, first, first ) ) );
+      UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, last, last ) ) );
+      UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map_32, first, first ) ) );
+      UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map_32, last, last ) ) );
+      ALWAYS_ASSERT( vt_bucket_count( &our_map ) == bucket_count );
+      ALWAYS_ASSERT( vt_bucket_count( &our_map_32 ) == bucket_count );
+
+      integer_map_with_identity_hash_itr itr = vt_first( &our_map );
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == first );
+      if( gap )
+      {
+        itr = vt_next( itr );
+        ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == last );
+      }
+      ALWAYS_ASSERT( vt_is_end( vt_next( itr ) ) );
+
+      integer_map_with_metadata_32_itr itr_32 = vt_first( &our_map_32 );
+      ALWAYS_ASSERT( !vt_is_end( itr_32 ) && itr_32.data->key == first );
+      if( gap )
+      {
+        itr_32 = vt_next( itr_32 );
+        ALWAYS_ASSERT( !vt_is_end( itr_32 ) && itr_32.data->key == last );
+      }
+      ALWAYS_ASSERT( vt_is_end( vt_next( itr_32 ) ) );
+
+      vt_clear( &our_map );
+      vt_clear( &our_map_32 );
+    }
+
+  vt_cleanup( &our_map );
+  vt_cleanup( &our_map_32 );
+}
+
 void test_map_dtors( void )
 {
   integer_dtors_map our_map;
@@ -685,6 +1827,127 @@ void test_map_strings( void )
   vt_cleanup( &our_map );
 }
 
+void test_map_lookup_key( void )
+{
+  // The keys are "k0" to "k999", and the buffer contains them all concatenated without terminators.
+  static char keys[ 1000 ][ 8 ];
+  static char buffer[ 1000 * 8 ];
+  size_t offsets[ 1001 ];
+  offsets[ 0 ] = 0;
+  for( size_t i = 0; i < 1000; ++i )
+  {
+    sprintf( keys[ i ], "k%zu", i );
+    memcpy( buffer + offsets[ i ], keys[ i ], strlen( keys[ i ] ) );
+    offsets[ i + 1 ] = offsets[ i ] + strlen( keys[ i ] );
+  }
+
+  string_map_with_lookup our_map;
+  vt_init( &our_map );
+
+  // Lookups in an empty table.
+  string_slice first_slice = { buffer, offsets[ 1 ] };
+  ALWAYS_ASSERT( vt_is_end( string_map_with_lookup_get_by( &our_map, first_slice ) ) );
+  ALWAYS_ASSERT( !string_map_with_lookup_erase_by( &our_map, first_slice ) );
+
+  // Insert via NULL-terminated keys, which also triggers incremental rehashes.
+  for( size_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, keys[ i ], i ) ) );
+
+  // Look up via slices, including slices that overlap the next key and therefore do not exist.
+  for( size_t i = 0; i < 1000; ++i )
+  {
+    string_slice slice = { buffer + offsets[ i ], offsets[ i + 1 ] - offsets[ i ] };
+    string_map_with_lookup_itr itr = string_map_with_lookup_get_by( &our_map, slice );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == keys[ i ] && itr.data->val == i );
+
+    ++slice.len;
+    ALWAYS_ASSERT( vt_is_end( string_map_with_lookup_get_by( &our_map, slice ) ) );
+  }
+
+  // Erase every second key via slices.
+  for( size_t i = 0; i < 1000; i += 2 )
+  {
+    string_slice slice = { buffer + offsets[ i ], offsets[ i + 1 ] - offsets[ i ] };
+    ALWAYS_ASSERT( string_map_with_lookup_erase_by( &our_map, slice ) );
+    ALWAYS_ASSERT( !string_map_with_lookup_erase_by( &our_map, slice ) );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_map ) == 500 );
+  for( size_t i = 0; i < 1000; ++i )
+  {
+    string_slice slice = { buffer + offsets[ i ], offsets[ i + 1 ] - offsets[ i ] };
+    ALWAYS_ASSERT( vt_is_end( string_map_with_lookup_get_by( &our_map, slice ) ) == ( i % 2 == 0 ) );
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_map, keys[ i ] ) ) == ( i % 2 == 0 ) );
+  }
+
+  vt_cleanup( &our_map );
+}
+
+void test_map_sso_strings( void )
+{
+  ALWAYS_ASSERT( sizeof( vt_sso_string ) == 24 );
+
+  // Test that lengths that do not fit in the len member are rejected (before the characters are read).
+  #if SIZE_MAX > UINT32_MAX
+  vt_sso_string too_long;
+  ALWAYS_ASSERT( !vt_sso_string_init( &too_long, "", (size_t)UINT32_MAX + 1 ) );
+  ALWAYS_ASSERT( !vt_sso_string_borrow( &too_long, "", (size_t)UINT32_MAX + 1 ) );
+  #endif
+
+  sso_string_map our_map;
+  vt_init( &our_map );
+
+  char buffer[ 64 ];
+  for( size_t i = 0; i < 1000; ++i )
+  {
+    vt_sso_string key;
+    ALWAYS_ASSERT( vt_sso_string_init( &key, buffer, write_padded_key( buffer, i ) ) );
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, key, i ) ) );
+  }
+
+  // Test replacing existing keys, which destroys the old keys.
+  for( size_t i = 0; i < 1000; i += 10 )
+  {
+    vt_sso_string key;
+    ALWAYS_ASSERT( vt_sso_string_init( &key, buffer, write_padded_key( buffer, i ) ) );
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, key, i + 1 ) ) );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_map ) == 1000 );
+
+  // Test lookups via borrowed strings, including misses that differ from existing keys only in their last character.
+  for( size_t i = 0; i < 1000; ++i )
+  {
+    size_t len = write_padded_key( buffer, i );
+    vt_sso_string borrowed;
+    ALWAYS_ASSERT( vt_sso_string_borrow( &borrowed, buffer, len ) );
+    sso_string_map_itr itr = vt_get( &our_map, borrowed );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == ( i % 10 ? i : i + 1 ) );
+    ALWAYS_ASSERT( itr.data->key.len == len && memcmp( vt_sso_string_chars( &itr.data->key ), buffer, len + 1 ) == 0 );
+
+    buffer[ len - 1 ] = 'x';
+    ALWAYS_ASSERT( vt_sso_string_borrow( &borrowed, buffer, len ) );
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_map, borrowed ) ) );
+  }
+
+  for( size_t i = 0; i < 1000; i += 2 )
+  {
+    vt_sso_string borrowed;
+    ALWAYS_ASSERT( vt_sso_string_borrow( &borrowed, buffer, write_padded_key( buffer, i ) ) );
+    ALWAYS_ASSERT( vt_erase( &our_map, borrowed ) );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_map ) == 500 );
+  for( size_t i = 0; i < 1000; ++i )
+  {
+    vt_sso_string borrowed;
+    ALWAYS_ASSERT( vt_sso_string_borrow( &borrowed, buffer, write_padded_key( buffer, i ) ) );
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_map, borrowed ) ) == ( i % 2 == 0 ) );
+  }
+
+  vt_cleanup( &our_map );
+}
+
 void test_map_with_ctx( void )
 {
   integer_map_with_ctx our_maps[ 10 ];
@@ -722,530 +1985,2976 @@ void test_map_with_ctx( void )
   }
 }
 
-// Set tests.
-
-void test_set_reserve( void )
+void test_map_with_stored_hash( void )
 {
-  integer_set our_set;
-  vt_init( &our_set );
-
-  // Reserve zero with placeholder.
-  UNTIL_SUCCESS( vt_reserve( &our_set, 0 ) );
-  ALWAYS_ASSERT( our_set.metadata == &vt_empty_placeholder_metadatum );
-
-  // Reserve up from placeholder.
-  UNTIL_SUCCESS( vt_reserve( &our_set, 30 ) );
-  ALWAYS_ASSERT( 30 <= vt_bucket_count( &our_set ) * GLOBAL_MAX_LOAD );
+  integer_map_with_stored_hash our_map;
+  vt_init( &our_map );
 
-  // Reserve same capacity.
-  size_t bucket_count = vt_bucket_count( &our_set );
-  UNTIL_SUCCESS( vt_reserve( &our_set, 30 ) );
-  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == bucket_count );
+  // Each insertion should hash only the new key, even though the table is rehashed many times and keys are evicted.
+  hash_calls = 0;
+  size_t expected_hash_calls = 0;
+  for( uint64_t i = 0; i < 500; ++i )
+  {
+    integer_map_with_stored_hash_itr itr;
+    UNTIL_SUCCESS( ( ++expected_hash_calls, !vt_is_end( itr = vt_insert( &our_map, i, i + 1 ) ) ) );
+    ALWAYS_ASSERT( itr.data->hash == vt_hash_integer( i ) );
+  }
 
-  // Reserve up from non-placeholder.
-  UNTIL_SUCCESS( vt_reserve( &our_set, 60 ) );
-  ALWAYS_ASSERT( 60 <= vt_bucket_count( &our_set ) * GLOBAL_MAX_LOAD );
+  ALWAYS_ASSERT( hash_calls == expected_hash_calls );
 
-  // Reserve lower capacity.
-  bucket_count = vt_bucket_count( &our_set );
-  UNTIL_SUCCESS( vt_reserve( &our_set, 30 ) );
-  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == bucket_count );
+  // Erasing during iteration, where the home bucket of each key is unknown, and shrinking should not hash any keys.
+  for(
+    integer_map_with_stored_hash_itr itr = vt_first( &our_map );
+    !vt_is_end( itr );
+  )
+  {
+    if( itr.data->key % 2 == 0 )
+      itr = vt_erase_itr( &our_map, itr );
+    else
+      itr = vt_next( itr );
+  }
 
-  // Test validity through use.
-  for( uint64_t i = 0; i < 60; ++i )
-    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+  UNTIL_SUCCESS( vt_shrink( &our_map ) );
+  ALWAYS_ASSERT( hash_calls == expected_hash_calls );
 
   // Check.
-  ALWAYS_ASSERT( vt_size( &our_set ) == 60 );
-  for( uint64_t i = 0; i < 60; ++i )
+  ALWAYS_ASSERT( vt_size( &our_map ) == 250 );
+  for( uint64_t i = 0; i < 500; ++i )
   {
-    integer_set_itr itr = vt_get( &our_set, i );
-    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    integer_map_with_stored_hash_itr itr = vt_get( &our_map, i );
+    if( i % 2 == 0 )
+      ALWAYS_ASSERT( vt_is_end( itr ) );
+    else
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == i + 1 && itr.data->hash == vt_hash_integer( i ) );
   }
 
-  vt_cleanup( &our_set );
+  vt_cleanup( &our_map );
 }
 
-void test_set_shrink( void )
+void test_map_separate_values( void )
 {
-  integer_set our_set;
-  vt_init( &our_set );
+  // The buckets hold only the keys.
+  ALWAYS_ASSERT( sizeof( integer_map_with_separate_values_bucket ) == sizeof( uint64_t ) );
 
-  // Test placeholder.
-  UNTIL_SUCCESS( vt_shrink( &our_set ) );
-  ALWAYS_ASSERT( vt_size( &our_set ) == 0 );
-  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == 0 );
+  integer_map_with_separate_values our_map;
+  vt_init( &our_map );
 
-  // Test restoration of placeholder.
-  UNTIL_SUCCESS( vt_reserve( &our_set, 30 ) );
-  UNTIL_SUCCESS( vt_shrink( &our_set ) );
-  ALWAYS_ASSERT( vt_size( &our_set ) == 0 );
-  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == 0 );
-  ALWAYS_ASSERT( our_set.metadata == &vt_empty_placeholder_metadatum );
+  // Insert, growing the table incrementally.
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    large_val val = { i + 1, { 0 } };
+    integer_map_with_separate_values_itr itr;
+    UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_map, i, val ) ) );
+    ALWAYS_ASSERT( itr.data->key == i && itr.val->n == i + 1 );
+  }
 
-  // Test shrink same size.
-  UNTIL_SUCCESS( vt_reserve( &our_set, 30 ) );
-  for( uint64_t i = 0; i < 30; ++i )
-    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+  // Values can be modified through iterators.
+  for( uint64_t i = 0; i < 1000; i += 2 )
+    vt_get( &our_map, i ).val->n *= 2;
 
-  ALWAYS_ASSERT( vt_size( &our_set ) == 30 );
-  void *buckets_ptr = (void *)our_set.buckets;
-  size_t bucket_count = vt_bucket_count( &our_set );
-  UNTIL_SUCCESS( vt_shrink( &our_set ) );
-  ALWAYS_ASSERT( (void *)our_set.buckets == buckets_ptr );
-  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == bucket_count );
+  // Erase every third key during iteration, which moves keys and values between buckets.
+  size_t n_iterations = 0;
+  for( integer_map_with_separate_values_itr itr = vt_first( &our_map ); !vt_is_end( itr ); ++n_iterations )
+  {
+    uint64_t key = itr.data->key;
+    ALWAYS_ASSERT( itr.val->n == ( key % 2 == 0 ? ( key + 1 ) * 2 : key + 1 ) );
+    if( key % 3 == 0 )
+      itr = vt_erase_itr( &our_map, itr );
+    else
+      itr = vt_next( itr );
+  }
 
-  // Test shrink down.
-  UNTIL_SUCCESS( vt_reserve( &our_set, 500 ) );
-  ALWAYS_ASSERT( vt_size( &our_set ) == 30 );
-  ALWAYS_ASSERT( 500 <= vt_bucket_count( &our_set ) * GLOBAL_MAX_LOAD );
-  UNTIL_SUCCESS( vt_shrink( &our_set ) );
-  ALWAYS_ASSERT( vt_size( &our_set ) == 30 );
-  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == bucket_count );
+  ALWAYS_ASSERT( n_iterations == 1000 );
 
-  // Check.
-  for( uint64_t i = 0; i < 30; ++i )
+  // Check, including via a clone and a frozen copy.
+  integer_map_with_separate_values clone;
+  UNTIL_SUCCESS( vt_init_clone( &clone, &our_map ) );
+
+  integer_map_with_separate_values_frozen frozen;
+  UNTIL_SUCCESS( vt_freeze( &our_map, &frozen ) );
+
+  ALWAYS_ASSERT( vt_size( &our_map ) == 666 && vt_size( &clone ) == 666 && vt_frozen_size( &frozen ) == 666 );
+  for( uint64_t i = 0; i < 1000; ++i )
   {
-    integer_set_itr itr = vt_get( &our_set, i );
-    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    uint64_t n = i % 2 == 0 ? ( i + 1 ) * 2 : i + 1;
+    integer_map_with_separate_values_itr itr = vt_get( &our_map, i );
+    integer_map_with_separate_values_itr clone_itr = vt_get( &clone, i );
+    const integer_map_with_separate_values_bucket *bucket = vt_frozen_get( &frozen, i );
+    if( i % 3 == 0 )
+      ALWAYS_ASSERT( vt_is_end( itr ) && vt_is_end( clone_itr ) && !bucket );
+    else
+    {
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.val->n == n );
+      ALWAYS_ASSERT( !vt_is_end( clone_itr ) && clone_itr.val->n == n );
+      ALWAYS_ASSERT( bucket && integer_map_with_separate_values_frozen_val( &frozen, bucket )->n == n );
+    }
   }
 
-  vt_cleanup( &our_set ); 
+  vt_frozen_cleanup( &frozen );
+  vt_cleanup( &clone );
+  vt_cleanup( &our_map );
 }
 
-void test_set_insert( void )
+void test_map_metadata_32( void )
 {
-  integer_set our_set;
-  vt_init( &our_set );
+  vt_table_stats stats;
 
-  // Insert new.
-  for( uint64_t i = 0; i < 100; ++i )
-  {
-    integer_set_itr itr;
-    UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, i ) ) );
-    ALWAYS_ASSERT( itr.data->key == i );
-  }
+  integer_map_with_metadata_32 our_map;
+  vt_init( &our_map );
 
-  // Insert existing.
-  for( uint64_t i = 0; i < 100; ++i )
-  {
-    integer_set_itr itr;
-    UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, i) ) );
-    ALWAYS_ASSERT( itr.data->key == i );
-  }
+  // Keys that differ only in bits 52 to 59 all belong to bucket 0 and share a 4-bit hash-code fragment, but their
+  // 12-bit fragments are distinct, so neither insertion nor lookup should call CMPR_FN on a mismatching key.
+  for( uint64_t i = 0; i < 200; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i << 52, i + 1 ) ) );
 
-  // Check.
-  for( uint64_t i = 0; i < 100; ++i )
+  for( uint64_t i = 0; i < 200; ++i )
   {
-    integer_set_itr itr;
-    itr = vt_get( &our_set, i );
-    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    integer_map_with_metadata_32_itr itr = vt_get( &our_map, i << 52 );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == i + 1 );
   }
 
-  vt_cleanup( &our_set );
-}
+  vt_stats( &our_map, &stats );
+  ALWAYS_ASSERT( stats.chain_count == 1 && stats.max_chain_length == 200 );
+  ALWAYS_ASSERT( stats.hashfrag_pair_count == 200 * 199 / 2 && stats.hashfrag_collision_count == 0 );
+  ALWAYS_ASSERT( stats.counters.cmpr_mismatches == 0 );
 
-void test_set_get_or_insert( void )
-{
-  integer_set our_set;
-  vt_init( &our_set );
+  // Occupy the first 2048 buckets in the quadratic probe sequence beginning at bucket 0, each with the key belonging
+  // there, so that the next key belonging to bucket 0 must be placed beyond the 11-bit displacement limit.
+  vt_clear( &our_map );
+  UNTIL_SUCCESS( vt_reserve( &our_map, 3000 ) );
+  ALWAYS_ASSERT( vt_bucket_count( &our_map ) == 4096 );
 
-  // Test insert.
-  for( uint64_t i = 0; i < 100; ++i )
+  for( uint64_t i = 0; i <= VT_DISPLACEMENT_MASK; ++i )
   {
-    integer_set_itr itr;
-    UNTIL_SUCCESS( !vt_is_end( itr = vt_get_or_insert( &our_set, i ) ) );
-    ALWAYS_ASSERT( itr.data->key == i );
+    uint64_t key = ( i * i + i ) / 2 % 4096;
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, key, key + 1 ) ) );
   }
 
-  ALWAYS_ASSERT( vt_size( &our_set ) == 100 );
-  for( uint64_t i = 0; i < 100; ++i )
+  UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, 4096, 4097 ) ) );
+
+  // The table should not have grown.
+  vt_stats( &our_map, &stats );
+  ALWAYS_ASSERT( vt_bucket_count( &our_map ) == 4096 );
+  ALWAYS_ASSERT( stats.max_displacement == VT_DISPLACEMENT_MASK + 1 );
+  ALWAYS_ASSERT( stats.counters.displacement_limit_rehashes == 0 );
+
+  // Erase every other key during iteration.
+  size_t n_iterations = 0;
+  for( integer_map_with_metadata_32_itr itr = vt_first( &our_map ); !vt_is_end( itr ); ++n_iterations )
   {
-    integer_set_itr itr = vt_get( &our_set, i );
-    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    if( itr.data->key % 2 == 0 )
+      itr = vt_erase_itr( &our_map, itr );
+    else
+      itr = vt_next( itr );
   }
 
-  // Test get.
-  for( uint64_t i = 0; i < 100; ++i )
+  ALWAYS_ASSERT( n_iterations == VT_DISPLACEMENT_MASK + 2 );
+
+  // Check.
+  for( uint64_t i = 0; i <= VT_DISPLACEMENT_MASK; ++i )
   {
-    integer_set_itr itr_1 = vt_get( &our_set, i );
-    ALWAYS_ASSERT( !vt_is_end( itr_1 ) );
-    integer_set_itr itr_2;
-    UNTIL_SUCCESS( !vt_is_end( itr_2 = vt_get_or_insert( &our_set, i ) ) );
-    ALWAYS_ASSERT( itr_2.data == itr_1.data && itr_2.data->key == i );
+    uint64_t key = ( i * i + i ) / 2 % 4096;
+    integer_map_with_metadata_32_itr itr = vt_get( &our_map, key );
+    if( key % 2 == 0 )
+      ALWAYS_ASSERT( vt_is_end( itr ) );
+    else
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == key + 1 );
   }
 
-  ALWAYS_ASSERT( vt_size( &our_set ) == 100 );
+  ALWAYS_ASSERT( vt_is_end( vt_get( &our_map, 4096 ) ) );
 
-  vt_cleanup( &our_set );
+  vt_cleanup( &our_map );
 }
 
-void test_set_get( void )
+// Returns the key inserted at the specified position in the insertion order used by the ordered-table tests, which
+// differs from the order of the keys' home buckets.
+static uint64_t ordered_key( uint64_t i )
 {
-  integer_set our_set;
-  vt_init( &our_set );
+  return i * 7919 % 1000;
+}
 
-  // Test empty.
-  for( uint64_t i = 0; i < 100; ++i )
-    ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) );
+void test_map_ordered( void )
+{
+  integer_map_ordered our_map;
+  vt_init( &our_map );
 
-  // Test get existing.
-  for( uint64_t i = 0; i < 100; ++i )
-    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+  // Insert, recording each key's position in the insertion order as its value.
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, ordered_key( i ), i ) ) );
 
-  for( uint64_t i = 0; i < 100; ++i )
+  // Replacing a key does not change its position.
+  for( uint64_t i = 0; i < 1000; i += 2 )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, ordered_key( i ), i ) ) );
+
+  // Iteration follows the insertion order.
+  // Erase every third key during iteration.
+  uint64_t n_iterations = 0;
+  for( integer_map_ordered_itr itr = vt_first( &our_map ); !vt_is_end( itr ); ++n_iterations )
   {
-    integer_set_itr itr = vt_get( &our_set, i );
-    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    ALWAYS_ASSERT( itr.data->key == ordered_key( n_iterations ) && itr.data->val == n_iterations );
+    if( n_iterations % 3 == 0 )
+      itr = vt_erase_itr( &our_map, itr );
+    else
+      itr = vt_next( itr );
   }
 
-  // Test get non-existing.
-  for( uint64_t i = 100; i < 200; ++i )
-    ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) );
-
-  vt_cleanup( &our_set );
-}
-
-void test_set_erase( void )
-{
-  integer_set our_set;
-  vt_init( &our_set );
+  ALWAYS_ASSERT( n_iterations == 1000 );
 
-  // Test erase existing.
-  for( uint64_t i = 0; i < 100; ++i )
-    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+  // Reinsert the erased keys, which should now follow the remaining keys.
+  for( uint64_t i = 0; i < 1000; i += 3 )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, ordered_key( i ), i + 1000 ) ) );
 
-  ALWAYS_ASSERT( vt_size( &our_set ) == 100 );
+  // Repeatedly inserting a key and erasing the previous one fills the entries array with erased entries, which should
+  // be reclaimed without the buckets array growing.
+  size_t bucket_count = vt_bucket_count( &our_map );
+  UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, 1000, 0 ) ) );
+  for( uint64_t i = 1000; i < 11000; ++i )
+  {
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i + 1, 0 ) ) );
+    ALWAYS_ASSERT( vt_erase( &our_map, i ) );
+  }
 
-  for( uint64_t i = 0; i < 100; i += 2 )
-    ALWAYS_ASSERT( vt_erase( &our_set, i ) );
+  ALWAYS_ASSERT( vt_erase( &our_map, 11000 ) );
+  ALWAYS_ASSERT( vt_bucket_count( &our_map ) == bucket_count );
 
-  // Test erase non-existing.
-  for( uint64_t i = 0; i < 100; i += 2 )
-    ALWAYS_ASSERT( !vt_erase( &our_set, i ) );
+  // Check the order, including via a clone and after shrinking.
+  integer_map_ordered clone;
+  UNTIL_SUCCESS( vt_init_clone( &clone, &our_map ) );
+  UNTIL_SUCCESS( vt_shrink( &our_map ) );
 
-  // Check.
-  ALWAYS_ASSERT( vt_size( &our_set ) == 50 );
-  for( uint64_t i = 0; i < 100; ++i )
+  integer_map_ordered *tables[] = { &our_map, &clone };
+  for( int i = 0; i < 2; ++i )
   {
-    if( i % 2 == 0 )
-      ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) );
-    else
+    ALWAYS_ASSERT( vt_size( tables[ i ] ) == 1000 );
+
+    // The remaining keys come first, skipping the positions of the erased keys, and then the reinserted keys follow in
+    // the same relative order, with values offset by 1000.
+    uint64_t expected = 1;
+    for( integer_map_ordered_itr itr = vt_first( tables[ i ] ); !vt_is_end( itr ); itr = vt_next( itr ) )
     {
-      integer_set_itr itr = vt_get( &our_set, i );
-      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+      ALWAYS_ASSERT( itr.data->val == expected && itr.data->key == ordered_key( expected % 1000 ) );
+      if( expected < 1000 )
+      {
+        expected += expected % 3 == 2 ? 2 : 1;
+        if( expected > 1000 )
+          expected = 1000;
+      }
+      else
+        expected += 3;
     }
+
+    ALWAYS_ASSERT( expected == 2002 );
   }
 
-  vt_cleanup( &our_set );
+  // Lookups find keys via their buckets' indices.
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    integer_map_ordered_itr itr = vt_get( &our_map, ordered_key( i ) );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == ( i % 3 == 0 ? i + 1000 : i ) );
+  }
+
+  // After the table is cleared, the order begins afresh.
+  vt_clear( &our_map );
+  for( uint64_t i = 0; i < 10; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, 999 - i, i ) ) );
+
+  n_iterations = 0;
+  for( integer_map_ordered_itr itr = vt_first( &our_map ); !vt_is_end( itr ); itr = vt_next( itr ) )
+    ALWAYS_ASSERT( itr.data->val == n_iterations++ );
+
+  ALWAYS_ASSERT( n_iterations == 10 );
+
+  vt_cleanup( &clone );
+  vt_cleanup( &our_map );
 }
 
-void test_set_erase_itr( void )
+void test_map_incremental_rehash( void )
 {
-  integer_set our_set;
-  vt_init( &our_set );
-
-  // In this instance, the key count and order of insert have been carefully chosen to cause skipped or repeat-visted
-  // keys if vt_erase_itr does not correctly handle the case of another key being moved to the bucket of the erased key.
-  for( int i = 119; i >= 0; --i )
-    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+  integer_map_incremental our_map;
+  vt_init( &our_map );
 
-  ALWAYS_ASSERT( vt_size( &our_set ) == 120 );
+  // Insert keys until an incremental rehash of a buckets array with at least 256 buckets is in progress.
+  uint64_t n = 0;
+  while( our_map.old_buckets_mask < 255 )
+  {
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, n, n + 1 ) ) );
+    ++n;
+  }
 
-  // Test with iterator from get.
-  for( uint64_t i = 0; i < 120; i += 4 )
-    vt_erase_itr( &our_set, vt_get( &our_set, i ) );
+  // Keys should now be split between the old and new buckets arrays.
+  ALWAYS_ASSERT( vt_size( &our_map ) == n );
+  ALWAYS_ASSERT( our_map.old_key_count > 0 && our_map.old_key_count < n );
 
-  // Check.
-  ALWAYS_ASSERT( vt_size( &our_set ) == 90 );
-  for( uint64_t i = 0; i < 120; ++i )
+  // Lookups and iteration, which do not advance the rehash, should find every key.
+  for( uint64_t i = 0; i < n + 100; ++i )
   {
-    if( i % 4 == 0 )
-      ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) );
+    integer_map_incremental_itr itr = vt_get( &our_map, i );
+    if( i < n )
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i && itr.data->val == i + 1 );
     else
-    {
-      integer_set_itr itr = vt_get( &our_set, i );
-      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
-    }
+      ALWAYS_ASSERT( vt_is_end( itr ) );
   }
 
-  // Test deletion while iterating.
-  integer_set_itr itr = vt_first( &our_set );
+  size_t old_key_count = our_map.old_key_count;
+  uint64_t key_sum = 0;
   size_t n_iterations = 0;
+  for( integer_map_incremental_itr itr = vt_first( &our_map ); !vt_is_end( itr ); itr = vt_next( itr ) )
+  {
+    key_sum += itr.data->key;
+    ++n_iterations;
+  }
+
+  ALWAYS_ASSERT( n_iterations == n && key_sum == n * ( n - 1 ) / 2 );
+  ALWAYS_ASSERT( our_map.old_key_count == old_key_count );
+
+  // Cloning should copy both buckets arrays.
+  integer_map_incremental clone;
+  UNTIL_SUCCESS( vt_init_clone( &clone, &our_map ) );
+  ALWAYS_ASSERT( vt_size( &clone ) == n && clone.old_key_count == old_key_count );
+  for( uint64_t i = 0; i < n; ++i )
+  {
+    integer_map_incremental_itr itr = vt_get( &clone, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == i + 1 );
+  }
+
+  vt_cleanup( &clone );
+
+  // Replace and get_or_insert should find keys in either buckets array and advance the rehash.
+  for( uint64_t i = 0; i + 1 < n; i += 8 )
+  {
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 2 ) ) );
+    integer_map_incremental_itr itr;
+    UNTIL_SUCCESS( !vt_is_end( itr = vt_get_or_insert( &our_map, i + 1, 0 ) ) );
+    ALWAYS_ASSERT( itr.data->key == i + 1 && itr.data->val == i + 2 );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_map ) == n );
+  for( uint64_t i = 0; i < n; ++i )
+    ALWAYS_ASSERT( vt_get( &our_map, i ).data->val == ( i % 8 == 0 && i + 1 < n ? i + 2 : i + 1 ) );
+  ALWAYS_ASSERT( our_map.old_key_count < old_key_count );
+
+  // Erasing during iteration should work across both buckets arrays.
+  n_iterations = 0;
+  integer_map_incremental_itr itr = vt_first( &our_map );
   while( !vt_is_end( itr ) )
   {
     ++n_iterations;
 
     if( itr.data->key % 2 == 0 )
-      itr = vt_erase_itr( &our_set, itr );
+      itr = vt_erase_itr( &our_map, itr );
     else
       itr = vt_next( itr );
   }
 
-  ALWAYS_ASSERT( n_iterations == 90 );
-  ALWAYS_ASSERT( vt_size( &our_set ) == 60 );
+  ALWAYS_ASSERT( n_iterations == n );
+  ALWAYS_ASSERT( vt_size( &our_map ) == n / 2 );
 
-  for( uint64_t i = 0; i < 120; ++i )
+  // Further insertions and erasures should complete the rehash.
+  for( uint64_t i = n; our_map.old_buckets_mask; ++i )
   {
     if( i % 2 == 0 )
-      ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) );
+      ALWAYS_ASSERT( !vt_erase( &our_map, i ) );
     else
-    {
-      itr = vt_get( &our_set, i );
-      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
-    }
+      UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+
+    if( i >= n * 2 ) // Just in case the above loop fails to finish.
+      ALWAYS_ASSERT( false );
   }
 
-  vt_cleanup( &our_set );
-}
+  ALWAYS_ASSERT( our_map.old_key_count == 0 && !our_map.old_buckets && !our_map.old_metadata );
 
-void test_set_clear( void )
-{
-  integer_set our_set;
-  vt_init( &our_set );
+  // Check.
+  for( uint64_t i = 0; i < n; ++i )
+  {
+    itr = vt_get( &our_map, i );
+    if( i % 2 == 0 )
+      ALWAYS_ASSERT( vt_is_end( itr ) );
+    else
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == i + 1 );
+  }
 
-  // Test empty.
-  vt_clear( &our_set );
-  ALWAYS_ASSERT( vt_size( &our_set ) == 0 );
+  // Clearing, shrinking, and cleaning up in the middle of an incremental rehash should free the old buckets array.
+  vt_clear( &our_map );
+  while( !our_map.old_buckets_mask )
+  {
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, n, n + 1 ) ) );
+    ++n;
+  }
 
-  // Test non-empty;
-  for( uint64_t i = 0; i < 100; ++i )
-    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+  vt_clear( &our_map );
+  ALWAYS_ASSERT( vt_size( &our_map ) == 0 && !our_map.old_buckets_mask );
 
-  vt_clear( &our_set );
-  ALWAYS_ASSERT( vt_size( &our_set ) == 0 );
-  for( uint64_t i = 0; i < 100; ++i )
-    ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) );
+  while( !our_map.old_buckets_mask )
+  {
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, n, n + 1 ) ) );
+    ++n;
+  }
 
-  // Test reuse.
-  for( uint64_t i = 0; i < 100; ++i )
-    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+  UNTIL_SUCCESS( vt_shrink( &our_map ) );
+  ALWAYS_ASSERT( !our_map.old_buckets_mask );
 
-  for( uint64_t i = 0; i < 100; ++i )
+  while( !our_map.old_buckets_mask )
   {
-    integer_set_itr itr = vt_get( &our_set, i );
-    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, n, n + 1 ) ) );
+    ++n;
   }
 
-  vt_cleanup( &our_set );
+  vt_cleanup( &our_map );
 }
 
-void test_set_cleanup( void )
+void test_map_stats( void )
 {
-  integer_set our_set;
-  vt_init( &our_set );
+  vt_table_stats stats;
 
-  // Empty.
-  vt_cleanup( &our_set );
-  ALWAYS_ASSERT( our_set.metadata == &vt_empty_placeholder_metadatum );
+  // Check the internal consistency of the statistics for a table with a good hash function.
+  integer_map our_map;
+  vt_init( &our_map );
 
-  // Non-empty.
-  for( uint64_t i = 0; i < 100; ++i )
-    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+  vt_stats( &our_map, &stats );
+  ALWAYS_ASSERT( stats.key_count == 0 && stats.bucket_count == 0 && stats.chain_count == 0 );
 
-  ALWAYS_ASSERT( vt_size( &our_set ) == 100 );
-  vt_cleanup( &our_set );
-  ALWAYS_ASSERT( vt_size( &our_set ) == 0 );
-  ALWAYS_ASSERT( our_set.metadata == &vt_empty_placeholder_metadatum );
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
 
-  // Test use.
-  for( uint64_t i = 0; i < 100; ++i )
-    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
-  for( uint64_t i = 0; i < 100; ++i )
+  vt_stats( &our_map, &stats );
+  ALWAYS_ASSERT( stats.key_count == 1000 && stats.bucket_count == vt_bucket_count( &our_map ) );
+
+  size_t chain_count = 0;
+  size_t key_count = 0;
+  for( size_t i = 0; i < VT_STATS_HISTOGRAM_LENGTH; ++i )
   {
-    integer_set_itr itr = vt_get( &our_set, i );
-    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    chain_count += stats.chain_length_histogram[ i ];
+    key_count += stats.displacement_histogram[ i ];
   }
 
-  vt_cleanup( &our_set );
-}
-
-void test_set_init_clone( void )
-{
-  integer_set src_set;
-  vt_init( &src_set );
+  ALWAYS_ASSERT( chain_count == stats.chain_count && key_count == 1000 );
+  ALWAYS_ASSERT( stats.chain_length_histogram[ 0 ] == 0 && stats.displacement_histogram[ 0 ] == stats.chain_count );
+  ALWAYS_ASSERT( stats.displaced_key_count == 1000 - stats.chain_count );
+  ALWAYS_ASSERT( stats.displaced_fraction == (double)stats.displaced_key_count / 1000 );
+  ALWAYS_ASSERT( stats.hashfrag_collision_count <= stats.hashfrag_pair_count );
+  ALWAYS_ASSERT( stats.max_chain_length >= 1 && stats.max_displacement < VT_DISPLACEMENT_MASK );
 
-  // Test init_clone placeholder.
-  integer_set empty_set;
-  UNTIL_SUCCESS( vt_init_clone( &empty_set, &src_set ) );
-  ALWAYS_ASSERT( empty_set.metadata == &vt_empty_placeholder_metadatum );
+  vt_cleanup( &our_map );
 
-  // Test init_clone non-placeholder.
-  integer_set our_set;
-  for( uint64_t i = 0; i < 10; ++i )
-    UNTIL_SUCCESS( !vt_is_end( vt_insert( &src_set, i ) ) );
-  UNTIL_SUCCESS( vt_init_clone( &our_set, &src_set ) );
+  // Check exact statistics and counters for a table whose layout is predictable.
+  integer_map_with_identity_hash identity_map;
+  vt_init( &identity_map );
 
-  // Check.
-  ALWAYS_ASSERT( vt_size( &our_set ) == 10 );
-  for( uint64_t i = 0; i < 10; ++i )
+  // Keys 0 and 8 both belong to bucket 0 in a table with eight buckets, so 8 is placed in bucket 1.
+  // Inserting 8 calls CMPR_FN on 0, which is a mismatch because the keys share a hash-code fragment.
+  // Key 1 then evicts 8 from bucket 1, so 8 is relocated to bucket 3, two quadratic displacements from bucket 0.
+  for( uint64_t i = 0; i < 3; ++i )
   {
-    integer_set_itr itr = vt_get( &our_set, i );
-    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    uint64_t key = i == 1 ? 8 : i / 2;
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &identity_map, key, key + 1 ) ) );
   }
 
-  vt_cleanup( &src_set );
-  vt_cleanup( &empty_set );
-  vt_cleanup( &our_set );
+  ALWAYS_ASSERT( vt_bucket_count( &identity_map ) == 8 );
+
+  // Looking up 8 calls CMPR_FN on 0 again.
+  ALWAYS_ASSERT( !vt_is_end( vt_get( &identity_map, 8 ) ) );
+
+  vt_stats( &identity_map, &stats );
+  ALWAYS_ASSERT( stats.key_count == 3 && stats.chain_count == 2 && stats.max_chain_length == 2 );
+  ALWAYS_ASSERT( stats.chain_length_histogram[ 1 ] == 1 && stats.chain_length_histogram[ 2 ] == 1 );
+  ALWAYS_ASSERT( stats.displacement_histogram[ 0 ] == 2 && stats.displacement_histogram[ 2 ] == 1 );
+  ALWAYS_ASSERT( stats.displaced_key_count == 1 && stats.max_displacement == 2 );
+  ALWAYS_ASSERT( stats.hashfrag_pair_count == 1 && stats.hashfrag_collision_count == 1 );
+  ALWAYS_ASSERT( stats.hashfrag_collision_rate == 1.0 );
+  ALWAYS_ASSERT( stats.counters.evictions == 1 );
+  ALWAYS_ASSERT( stats.counters.cmpr_mismatches == 2 );
+  ALWAYS_ASSERT( stats.counters.displacement_limit_rehashes == 0 );
+
+  vt_cleanup( &identity_map );
 }
 
-void test_set_iteration( void )
+void test_map_freeze( void )
 {
-  integer_set our_set;
-  vt_init( &our_set );
+  integer_map our_map;
+  vt_init( &our_map );
 
-  // Empty.
+  // Freeze empty.
+  integer_map_frozen frozen;
+  UNTIL_SUCCESS( vt_freeze( &our_map, &frozen ) );
+  ALWAYS_ASSERT( vt_frozen_size( &frozen ) == 0 );
+  ALWAYS_ASSERT( !vt_frozen_get( &frozen, 0 ) );
+  vt_frozen_cleanup( &frozen );
 
-  // Test fist.
-  ALWAYS_ASSERT( vt_is_end( vt_first( &our_set ) ) );
+  // Freeze non-empty after erasing every third key.
+  for( uint64_t i = 0; i < 3000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
 
-  size_t n_iterations = 0;
+  for( uint64_t i = 0; i < 3000; i += 3 )
+    ALWAYS_ASSERT( vt_erase( &our_map, i ) );
 
-  for(
-    integer_set_itr itr = vt_first( &our_set );
-    !vt_is_end( itr );
-    itr = vt_next( itr )
-  )
-    ++n_iterations;
+  UNTIL_SUCCESS( vt_freeze( &our_map, &frozen ) );
+  ALWAYS_ASSERT( vt_frozen_size( &frozen ) == 2000 );
+  ALWAYS_ASSERT( (uintptr_t)frozen.blocks % VT_FROZEN_ALIGNMENT == 0 );
 
-  ALWAYS_ASSERT( n_iterations == 0 );
+  // 16-byte buckets fit seven per two cache lines, rather than three per line.
+  ALWAYS_ASSERT( integer_map_frozen_line_count == 2 && integer_map_frozen_slot_count == 7 );
+  ALWAYS_ASSERT( sizeof( integer_map_frozen_block ) == 2 * VT_FROZEN_LINE_SIZE );
 
-  // Non-empty.
-  for( uint64_t i = 0; i < 30; ++i )
-    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+  // Test that the frozen table is independent of the source.
+  vt_clear( &our_map );
 
-  for(
-    integer_set_itr itr = vt_first( &our_set );
-    !vt_is_end( itr );
-    itr = vt_next( itr )
-  )
-    ++n_iterations;
+  for( uint64_t i = 0; i < 6000; ++i )
+  {
+    const integer_map_bucket *bucket = vt_frozen_get( &frozen, i );
+    if( i < 3000 && i % 3 )
+      ALWAYS_ASSERT( bucket && bucket->key == i && bucket->val == i + 1 );
+    else
+      ALWAYS_ASSERT( !bucket );
+  }
 
-  ALWAYS_ASSERT( n_iterations == 30 );
+  vt_frozen_cleanup( &frozen );
+  ALWAYS_ASSERT( vt_frozen_size( &frozen ) == 0 && !vt_frozen_get( &frozen, 1 ) );
+  vt_cleanup( &our_map );
 
-  vt_cleanup( &our_set );
+  // Test keys that all share the first home block and must overflow into more than UINT8_MAX following blocks.
+  // Multiplying by the inverse of VT_FROZEN_MIXER makes the remixed hash code of key i * inverse equal to i, so keys
+  // below 2^32 all map to the first home block, and keys that differ only in their low 24 bits share a fragment.
+  const uint64_t inverse_mixer = 0xF1DE83E19937733Dull;
+  integer_map_with_identity_hash identity_map;
+  vt_init( &identity_map );
+  for( uint64_t i = 0; i < 3000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &identity_map, ( i << 20 ) * inverse_mixer, i ) ) );
+
+  integer_map_with_identity_hash_frozen identity_frozen;
+  UNTIL_SUCCESS( vt_freeze( &identity_map, &identity_frozen ) );
+  ALWAYS_ASSERT( identity_frozen.blocks[ 0 ].content.extra_block_count == UINT8_MAX );
+  for( uint64_t i = 0; i < 3000; i += 7 )
+  {
+    const integer_map_with_identity_hash_bucket *bucket =
+      vt_frozen_get( &identity_frozen, ( i << 20 ) * inverse_mixer );
+    ALWAYS_ASSERT( bucket && bucket->val == i );
+    ALWAYS_ASSERT( !vt_frozen_get( &identity_frozen, ( ( i << 20 ) + 1 ) * inverse_mixer ) );
+  }
+
+  vt_frozen_cleanup( &identity_frozen );
+  vt_cleanup( &identity_map );
 }
 
-void test_set_dtors( void )
+void test_map_concurrent( void )
 {
-  integer_dtors_set our_set;
-  integer_dtors_set_init( &our_set );
+  shard_integer_map_concurrent our_map;
+  ALWAYS_ASSERT( shard_integer_map_concurrent_init( &our_map ) );
 
-  // Test erase and clear.
+  // Insert.
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( shard_integer_map_concurrent_insert( &our_map, i, i + 1 ) );
 
-  for( uint64_t i = 0; i < 100; ++i )
-    UNTIL_SUCCESS( !integer_dtors_set_is_end( integer_dtors_set_insert( &our_set, i ) ) );
+  ALWAYS_ASSERT( shard_integer_map_concurrent_size( &our_map ) == 1000 );
 
-  for( uint64_t i = 0; i < 100; i += 2 ) // TODO: Fix in CC
-    integer_dtors_set_erase( &our_set, i );
+  // Check that the keys are spread across all shards and that each key is in the shard that its hash code selects.
+  size_t total = 0;
+  for( size_t i = 0; i < 4; ++i )
+  {
+    ALWAYS_ASSERT( vt_size( &our_map.shards[ i ].table ) > 0 );
+    total += vt_size( &our_map.shards[ i ].table );
+  }
+  ALWAYS_ASSERT( total == 1000 );
 
-  integer_dtors_set_clear( &our_set );
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    size_t shard_index = ( ( vt_hash_integer( i ) >> 32 ) & 0xFFFFF ) % 4;
+    ALWAYS_ASSERT( !vt_is_end( vt_get( &our_map.shards[ shard_index ].table, i ) ) );
+  }
 
-  check_dtors_arr();
+  // Get.
+  for( uint64_t i = 0; i < 2000; ++i )
+  {
+    uint64_t val = 0;
+    ALWAYS_ASSERT( shard_integer_map_concurrent_get( &our_map, i, &val ) == ( i < 1000 ) );
+    ALWAYS_ASSERT( val == ( i < 1000 ? i + 1 : 0 ) );
+  }
 
-  // Test replace.
+  ALWAYS_ASSERT( shard_integer_map_concurrent_get( &our_map, 0, NULL ) );
 
-  for( uint64_t i = 0; i < 100; ++i )
-    UNTIL_SUCCESS( !integer_dtors_set_is_end( integer_dtors_set_insert( &our_set, i ) ) );
+  // Replace.
+  for( uint64_t i = 0; i < 1000; i += 2 )
+    UNTIL_SUCCESS( shard_integer_map_concurrent_insert( &our_map, i, i + 2 ) );
 
-  for( uint64_t i = 0; i < 100; ++i )
-    UNTIL_SUCCESS( !integer_dtors_set_is_end( integer_dtors_set_insert( &our_set, i ) ) );
+  ALWAYS_ASSERT( shard_integer_map_concurrent_size( &our_map ) == 1000 );
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    uint64_t val;
+    ALWAYS_ASSERT( shard_integer_map_concurrent_get( &our_map, i, &val ) );
+    ALWAYS_ASSERT( val == ( i % 2 == 0 ? i + 2 : i + 1 ) );
+  }
+
+  // Erase.
+  for( uint64_t i = 1; i < 1000; i += 2 )
+  {
+    ALWAYS_ASSERT( shard_integer_map_concurrent_erase( &our_map, i ) );
+    ALWAYS_ASSERT( !shard_integer_map_concurrent_erase( &our_map, i ) );
+  }
+
+  ALWAYS_ASSERT( shard_integer_map_concurrent_size( &our_map ) == 500 );
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( shard_integer_map_concurrent_get( &our_map, i, NULL ) == ( i % 2 == 0 ) );
+
+  // Lock and unlock.
+  shard_integer_map *shard = shard_integer_map_concurrent_lock( &our_map, 1000 );
+  ALWAYS_ASSERT( shard == &our_map.shards[ ( ( vt_hash_integer( 1000 ) >> 32 ) & 0xFFFFF ) % 4 ].table );
+  UNTIL_SUCCESS( !vt_is_end( vt_get_or_insert( shard, 1000, 1234 ) ) );
+  ++vt_get( shard, 1000 ).data->val;
+  shard_integer_map_concurrent_unlock( &our_map, shard );
+
+  uint64_t val;
+  ALWAYS_ASSERT( shard_integer_map_concurrent_get( &our_map, 1000, &val ) && val == 1235 );
+  ALWAYS_ASSERT( shard_integer_map_concurrent_size( &our_map ) == 501 );
+
+  // Clear.
+  shard_integer_map_concurrent_clear( &our_map );
+  ALWAYS_ASSERT( shard_integer_map_concurrent_size( &our_map ) == 0 );
+  ALWAYS_ASSERT( !shard_integer_map_concurrent_get( &our_map, 0, NULL ) );
+
+  UNTIL_SUCCESS( shard_integer_map_concurrent_insert( &our_map, 0, 1 ) );
+  ALWAYS_ASSERT( shard_integer_map_concurrent_size( &our_map ) == 1 );
+
+  shard_integer_map_concurrent_cleanup( &our_map );
+}
+
+// State shared by the writer and reader threads in the seqlock stress test below.
+typedef struct
+{
+  vt_thread thread;
+  integer_map_seqlock *map;
+  size_t *done;
+} seqlock_reader;
+
+#define SEQLOCK_STRESS_KEY_COUNT ( (uint64_t)1 << 17 )
+
+// Looks up keys until the writer finishes, checking that every key found has the correct value.
+void seqlock_stress_read( void *arg )
+{
+  seqlock_reader *reader = (seqlock_reader *)arg;
+
+  for( uint64_t i = 0; !vt_load_size_relaxed( reader->done ); i = ( i + 7919 ) % SEQLOCK_STRESS_KEY_COUNT )
+  {
+    uint64_t val;
+    if( integer_map_seqlock_get_concurrent( reader->map, i, &val ) )
+      ALWAYS_ASSERT( val == i + 1 );
+  }
+}
+
+void test_map_seqlock( void )
+{
+  integer_map_seqlock our_map;
+  vt_init( &our_map );
+
+  ALWAYS_ASSERT( !integer_map_seqlock_get_concurrent( &our_map, 0, NULL ) );
+
+  // Insert keys, checking that each modification leaves the sequence counter even and advanced.
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    size_t seq = our_map.seq;
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+    ALWAYS_ASSERT( our_map.seq % 2 == 0 && our_map.seq > seq );
+  }
+
+  // Growing the table retired the replaced buckets arrays rather than freeing them.
+  ALWAYS_ASSERT( our_map.retired );
+
+  // Get.
+  for( uint64_t i = 0; i < 2000; ++i )
+  {
+    size_t seq = our_map.seq;
+    uint64_t val = 0;
+    ALWAYS_ASSERT( integer_map_seqlock_get_concurrent( &our_map, i, &val ) == ( i < 1000 ) );
+    ALWAYS_ASSERT( val == ( i < 1000 ? i + 1 : 0 ) );
+    ALWAYS_ASSERT( our_map.seq == seq );
+  }
+
+  // Replace.
+  for( uint64_t i = 0; i < 1000; i += 2 )
+  {
+    size_t seq = our_map.seq;
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 2 ) ) );
+    ALWAYS_ASSERT( our_map.seq % 2 == 0 && our_map.seq > seq );
+  }
+
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    uint64_t val;
+    ALWAYS_ASSERT( integer_map_seqlock_get_concurrent( &our_map, i, &val ) );
+    ALWAYS_ASSERT( val == ( i % 2 == 0 ? i + 2 : i + 1 ) );
+  }
+
+  // Erase.
+  for( uint64_t i = 1; i < 1000; i += 2 )
+  {
+    size_t seq = our_map.seq;
+    ALWAYS_ASSERT( vt_erase( &our_map, i ) );
+    ALWAYS_ASSERT( our_map.seq % 2 == 0 && our_map.seq > seq );
+  }
+
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( integer_map_seqlock_get_concurrent( &our_map, i, NULL ) == ( i % 2 == 0 ) );
+
+  // Reclaim.
+  integer_map_seqlock_reclaim( &our_map );
+  ALWAYS_ASSERT( !our_map.retired );
+
+  // Shrink, which retires the buckets array again.
+  UNTIL_SUCCESS( vt_shrink( &our_map ) );
+  ALWAYS_ASSERT( our_map.retired && our_map.seq % 2 == 0 );
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( integer_map_seqlock_get_concurrent( &our_map, i, NULL ) == ( i % 2 == 0 ) );
+
+  // Clear.
+  size_t seq = our_map.seq;
+  vt_clear( &our_map );
+  ALWAYS_ASSERT( our_map.seq % 2 == 0 && our_map.seq > seq );
+  ALWAYS_ASSERT( !integer_map_seqlock_get_concurrent( &our_map, 0, NULL ) );
+
+  // Shrink to zero buckets, leaving a retired buckets array for NAME_cleanup to free.
+  UNTIL_SUCCESS( vt_shrink( &our_map ) );
+  ALWAYS_ASSERT( vt_bucket_count( &our_map ) == 0 && our_map.retired );
+  ALWAYS_ASSERT( !integer_map_seqlock_get_concurrent( &our_map, 0, NULL ) );
+
+  vt_cleanup( &our_map );
+  ALWAYS_ASSERT( !our_map.retired );
+
+  // Stress test: readers look up keys while the writer grows the table and shrinks it to zero buckets.
+  // The replaced buckets arrays are not reclaimed until the end, so readers never access freed memory.
+  vt_init( &our_map );
+  size_t done = 0;
+
+  seqlock_reader readers[ 4 ];
+  size_t reader_count = 0;
+  for( size_t i = 0; i < 4; ++i )
+  {
+    readers[ reader_count ].map = &our_map;
+    readers[ reader_count ].done = &done;
+    if( vt_thread_create( &readers[ reader_count ].thread, seqlock_stress_read, &readers[ reader_count ] ) )
+      ++reader_count;
+  }
+
+  // Since the whole test is repeated many times, one growth and shrink per call suffices.
+  for( uint64_t i = 0; i < SEQLOCK_STRESS_KEY_COUNT; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+
+  vt_clear( &our_map );
+  UNTIL_SUCCESS( vt_shrink( &our_map ) );
+  ALWAYS_ASSERT( vt_bucket_count( &our_map ) == 0 );
+
+  vt_store_size_relaxed( &done, 1 );
+  for( size_t i = 0; i < reader_count; ++i )
+    vt_thread_join( &readers[ i ].thread );
+
+  vt_cleanup( &our_map );
+}
+
+void test_map_reserve_parallel( void )
+{
+  parallel_integer_map our_map;
+  vt_init( &our_map );
+
+  // Reserve up from placeholder, which rehashes in the calling thread.
+  UNTIL_SUCCESS( parallel_integer_map_reserve_parallel( &our_map, 30, 4 ) );
+  ALWAYS_ASSERT( 30 <= vt_bucket_count( &our_map ) * GLOBAL_MAX_LOAD );
+
+  for( uint64_t i = 0; i < 2000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+
+  // Reserve up with various thread counts, including more threads than the bucket count permits.
+  size_t sizes[] = { 4000, 8000, 16000, 32000 };
+  unsigned int thread_counts[] = { 2, 3, 8, 1000 };
+  for( int j = 0; j < 4; ++j )
+  {
+    UNTIL_SUCCESS( parallel_integer_map_reserve_parallel( &our_map, sizes[ j ], thread_counts[ j ] ) );
+    ALWAYS_ASSERT( sizes[ j ] <= vt_bucket_count( &our_map ) * GLOBAL_MAX_LOAD );
+    ALWAYS_ASSERT( vt_size( &our_map ) == 2000 );
+    for( uint64_t i = 0; i < 2000; ++i )
+    {
+      parallel_integer_map_itr itr = vt_get( &our_map, i );
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i && itr.data->val == i + 1 );
+    }
+  }
+
+  // Reserve lower capacity.
+  size_t bucket_count = vt_bucket_count( &our_map );
+  UNTIL_SUCCESS( parallel_integer_map_reserve_parallel( &our_map, 4000, 4 ) );
+  ALWAYS_ASSERT( vt_bucket_count( &our_map ) == bucket_count );
+
+  // Test validity through use.
+  for( uint64_t i = 0; i < 2000; i += 2 )
+    ALWAYS_ASSERT( vt_erase( &our_map, i ) );
+
+  for( uint64_t i = 2000; i < 4000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+
+  ALWAYS_ASSERT( vt_size( &our_map ) == 3000 );
+  for( uint64_t i = 0; i < 4000; ++i )
+  {
+    parallel_integer_map_itr itr = vt_get( &our_map, i );
+    if( i < 2000 && i % 2 == 0 )
+      ALWAYS_ASSERT( vt_is_end( itr ) );
+    else
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i && itr.data->val == i + 1 );
+  }
+
+  // Reserve up from an empty table with buckets.
+  vt_clear( &our_map );
+  UNTIL_SUCCESS( parallel_integer_map_reserve_parallel( &our_map, 64000, 4 ) );
+  ALWAYS_ASSERT( vt_size( &our_map ) == 0 && 64000 <= vt_bucket_count( &our_map ) * GLOBAL_MAX_LOAD );
+
+  vt_cleanup( &our_map );
+
+  // Keys whose hash codes share their low 16 bits share a home bucket, so a thread whose bucket range covers only a
+  // small fraction of the buckets cannot place many of them and defers the rest to the calling thread.
+  // With enough such keys, the threads' deferred arrays fill up, and the function falls back on a serial rehash.
+  parallel_integer_map_with_identity_hash identity_map;
+  vt_init( &identity_map );
+  UNTIL_SUCCESS( vt_reserve( &identity_map, 4000 ) );
+
+  uint64_t key_counts[] = { 160, 400 };
+  for( int j = 0; j < 2; ++j )
+  {
+    for( uint64_t i = j ? key_counts[ j - 1 ] : 0; i < key_counts[ j ]; ++i )
+      UNTIL_SUCCESS( !vt_is_end( vt_insert( &identity_map, i << 16, i ) ) );
+
+    size_t size = vt_bucket_count( &identity_map ) * 2 * GLOBAL_MAX_LOAD;
+    UNTIL_SUCCESS( parallel_integer_map_with_identity_hash_reserve_parallel( &identity_map, size, 16 ) );
+    ALWAYS_ASSERT( vt_size( &identity_map ) == key_counts[ j ] );
+    for( uint64_t i = 0; i < key_counts[ j ]; ++i )
+    {
+      parallel_integer_map_with_identity_hash_itr itr = vt_get( &identity_map, i << 16 );
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i << 16 && itr.data->val == i );
+    }
+  }
+
+  vt_cleanup( &identity_map );
+}
+
+void test_map_build_parallel( void )
+{
+  parallel_integer_map our_map;
+  vt_init( &our_map );
+
+  uint64_t keys[ 5000 ];
+  uint64_t vals[ 5000 ];
+  for( uint64_t i = 0; i < 5000; ++i )
+  {
+    keys[ i ] = i;
+    vals[ i ] = i + 1;
+  }
+
+  // Build nothing.
+  UNTIL_SUCCESS( parallel_integer_map_build_parallel( &our_map, keys, vals, 0, 4 ) );
+  ALWAYS_ASSERT( vt_size( &our_map ) == 0 );
+
+  // Build an empty table.
+  UNTIL_SUCCESS( parallel_integer_map_build_parallel( &our_map, keys, vals, 4000, 8 ) );
+  ALWAYS_ASSERT( vt_size( &our_map ) == 4000 );
+  ALWAYS_ASSERT( 4000 <= vt_bucket_count( &our_map ) * GLOBAL_MAX_LOAD );
+  for( uint64_t i = 0; i < 5000; ++i )
+  {
+    parallel_integer_map_itr itr = vt_get( &our_map, i );
+    if( i < 4000 )
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i && itr.data->val == i + 1 );
+    else
+      ALWAYS_ASSERT( vt_is_end( itr ) );
+  }
+
+  // Build a non-empty table, which inserts the keys in the calling thread.
+  UNTIL_SUCCESS( parallel_integer_map_build_parallel( &our_map, keys + 3000, vals + 3000, 2000, 8 ) );
+  ALWAYS_ASSERT( vt_size( &our_map ) == 5000 );
+  for( uint64_t i = 0; i < 5000; ++i )
+  {
+    parallel_integer_map_itr itr = vt_get( &our_map, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i && itr.data->val == i + 1 );
+  }
+
+  // Build an empty table from keys containing duplicates, the last of each of which is retained, as with NAME_insert.
+  vt_clear( &our_map );
+  for( uint64_t i = 0; i < 5000; ++i )
+  {
+    keys[ i ] = i % 3000;
+    vals[ i ] = i;
+  }
+
+  UNTIL_SUCCESS( parallel_integer_map_build_parallel( &our_map, keys, vals, 5000, 8 ) );
+  ALWAYS_ASSERT( vt_size( &our_map ) == 3000 );
+  for( uint64_t i = 0; i < 3000; ++i )
+  {
+    parallel_integer_map_itr itr = vt_get( &our_map, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    ALWAYS_ASSERT( itr.data->val == ( i < 2000 ? i + 3000 : i ) );
+  }
+
+  vt_cleanup( &our_map );
+
+  // Keys that share a home bucket are deferred to the calling thread (see test_map_reserve_parallel).
+  parallel_integer_map_with_identity_hash identity_map;
+  vt_init( &identity_map );
+
+  for( uint64_t i = 0; i < 400; ++i )
+  {
+    keys[ i ] = i << 16;
+    vals[ i ] = i;
+  }
+
+  UNTIL_SUCCESS( parallel_integer_map_with_identity_hash_build_parallel( &identity_map, keys, vals, 400, 16 ) );
+  ALWAYS_ASSERT( vt_size( &identity_map ) == 400 );
+  for( uint64_t i = 0; i < 400; ++i )
+  {
+    parallel_integer_map_with_identity_hash_itr itr = vt_get( &identity_map, i << 16 );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i << 16 && itr.data->val == i );
+  }
+
+  vt_clear( &identity_map );
+
+  // Duplicates of keys that share a home bucket, some copies of which are deferred while others are placed by the
+  // threads, interleaved with duplicates of keys spread across all the threads' ranges.
+  // Again, the last copy of each key is retained.
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    keys[ i ] = i % 2 ? ( ( i / 2 ) % 200 ) << 16 : ( ( i / 2 ) % 300 ) * 7 + 1;
+    vals[ i ] = i;
+  }
+
+  UNTIL_SUCCESS( parallel_integer_map_with_identity_hash_build_parallel( &identity_map, keys, vals, 1000, 16 ) );
+  ALWAYS_ASSERT( vt_size( &identity_map ) == 500 );
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    uint64_t last = 999;
+    while( keys[ last ] != keys[ i ] )
+      --last;
+
+    parallel_integer_map_with_identity_hash_itr itr = vt_get( &identity_map, keys[ i ] );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == last );
+  }
+
+  vt_cleanup( &identity_map );
+}
+
+void test_map_save_load( void )
+{
+  const char *path = "vt_unit_test_map.bin";
+  FILE *file;
+  bool saved;
+
+  serialized_integer_map our_map;
+  vt_init( &our_map );
+
+  // Test save and load empty.
+  file = fopen( path, "wb" );
+  ALWAYS_ASSERT( file );
+  ALWAYS_ASSERT( serialized_integer_map_save( &our_map, file ) );
+  fclose( file );
+
+  serialized_integer_map loaded;
+  ALWAYS_ASSERT( serialized_integer_map_load_mmap( &loaded, path ) );
+  ALWAYS_ASSERT( vt_size( &loaded ) == 0 && vt_bucket_count( &loaded ) == 0 );
+  vt_cleanup( &loaded );
+
+  // Test save and load non-empty.
+  // Saving may complete an incremental rehash, which can fail because of allocation failure.
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+
+  do
+  {
+    file = fopen( path, "wb" );
+    ALWAYS_ASSERT( file );
+    saved = serialized_integer_map_save( &our_map, file );
+    fclose( file );
+  } while( !saved );
+
+  ALWAYS_ASSERT( serialized_integer_map_load_mmap( &loaded, path ) );
+  ALWAYS_ASSERT( vt_size( &loaded ) == 1000 && vt_bucket_count( &loaded ) == vt_bucket_count( &our_map ) );
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    serialized_integer_map_itr itr = vt_get( &loaded, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == i + 1 );
+  }
+
+  size_t iterated_count = 0;
+  for( serialized_integer_map_itr itr = vt_first( &loaded ); !vt_is_end( itr ); itr = vt_next( itr ) )
+    ++iterated_count;
+
+  ALWAYS_ASSERT( iterated_count == 1000 );
+
+  // Test that modifications do not affect the file.
+  for( uint64_t i = 0; i < 500; ++i )
+  {
+    vt_get( &loaded, i ).data->val = 0;
+    ALWAYS_ASSERT( vt_erase( &loaded, i + 500 ) );
+  }
+
+  serialized_integer_map reloaded;
+  ALWAYS_ASSERT( serialized_integer_map_load_mmap( &reloaded, path ) );
+  ALWAYS_ASSERT( vt_size( &reloaded ) == 1000 );
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( vt_get( &reloaded, i ).data->val == i + 1 );
+
+  // Test growing the loaded table, which replaces the mapped buckets array.
+  for( uint64_t i = 1000; i < 3000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &loaded, i, i + 1 ) ) );
+
+  ALWAYS_ASSERT( vt_size( &loaded ) == 2500 );
+  for( uint64_t i = 0; i < 3000; ++i )
+  {
+    serialized_integer_map_itr itr = vt_get( &loaded, i );
+    if( i < 500 )
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == 0 );
+    else if( i < 1000 )
+      ALWAYS_ASSERT( vt_is_end( itr ) );
+    else
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == i + 1 );
+  }
+
+  vt_cleanup( &loaded );
+
+  // Test shrinking the loaded table to zero buckets.
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( vt_erase( &reloaded, i ) );
+
+  UNTIL_SUCCESS( vt_shrink( &reloaded ) );
+  ALWAYS_ASSERT( vt_bucket_count( &reloaded ) == 0 );
+  vt_cleanup( &reloaded );
+
+  // Test incompatible files.
+  // A file saved by a template that uses a different hash function is caught by the check of the first few keys.
+  serialized_integer_map_with_identity_hash identity_map;
+  ALWAYS_ASSERT( !serialized_integer_map_with_identity_hash_load_mmap( &identity_map, path ) );
+  ALWAYS_ASSERT( vt_size( &identity_map ) == 0 && vt_bucket_count( &identity_map ) == 0 );
+  vt_cleanup( &identity_map );
+
+  serialized_integer_set set;
+  ALWAYS_ASSERT( !serialized_integer_set_load_mmap( &set, path ) );
+  vt_cleanup( &set );
+
+  // Test truncated file.
+  file = fopen( path, "rb" );
+  ALWAYS_ASSERT( file );
+  vt_file_header header;
+  ALWAYS_ASSERT( fread( &header, sizeof( vt_file_header ), 1, file ) == 1 );
+  fclose( file );
+
+  file = fopen( path, "wb" );
+  ALWAYS_ASSERT( file );
+  ALWAYS_ASSERT( fwrite( &header, sizeof( vt_file_header ), 1, file ) == 1 );
+  fclose( file );
+
+  ALWAYS_ASSERT( !serialized_integer_map_load_mmap( &loaded, path ) );
+  vt_cleanup( &loaded );
+
+  // Test non-existent file.
+  remove( path );
+  ALWAYS_ASSERT( !serialized_integer_map_load_mmap( &loaded, path ) );
+
+  // Test that a table whose load failed is usable.
+  UNTIL_SUCCESS( !vt_is_end( vt_insert( &loaded, 1, 2 ) ) );
+  ALWAYS_ASSERT( vt_get( &loaded, 1 ).data->val == 2 );
+  vt_cleanup( &loaded );
+
+  vt_cleanup( &our_map );
+
+  // Test a table that also supports the parallel functions.
+  parallel_serialized_integer_map parallel_map;
+  vt_init( &parallel_map );
+
+  uint64_t keys[ 1000 ];
+  uint64_t vals[ 1000 ];
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    keys[ i ] = i;
+    vals[ i ] = i + 1;
+  }
+
+  UNTIL_SUCCESS( parallel_serialized_integer_map_build_parallel( &parallel_map, keys, vals, 1000, 4 ) );
+
+  file = fopen( path, "wb" );
+  ALWAYS_ASSERT( file );
+  ALWAYS_ASSERT( parallel_serialized_integer_map_save( &parallel_map, file ) );
+  fclose( file );
+
+  parallel_serialized_integer_map parallel_loaded;
+  ALWAYS_ASSERT( parallel_serialized_integer_map_load_mmap( &parallel_loaded, path ) );
+  ALWAYS_ASSERT( vt_size( &parallel_loaded ) == 1000 );
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( vt_get( &parallel_loaded, i ).data->val == i + 1 );
+
+  vt_cleanup( &parallel_loaded );
+  vt_cleanup( &parallel_map );
+  remove( path );
+
+  // Test a table instantiated in HEADER_MODE and IMPLEMENTATION_MODE.
+  header_mode_integer_map header_map;
+  vt_init( &header_map );
+
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &header_map, i, i + 1 ) ) );
+
+  do
+  {
+    file = fopen( path, "wb" );
+    ALWAYS_ASSERT( file );
+    saved = header_mode_integer_map_save( &header_map, file );
+    fclose( file );
+  } while( !saved );
+
+  header_mode_integer_map header_loaded;
+  ALWAYS_ASSERT( header_mode_integer_map_load_mmap( &header_loaded, path ) );
+  ALWAYS_ASSERT( vt_size( &header_loaded ) == 1000 );
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( vt_get( &header_loaded, i ).data->val == i + 1 );
+
+  vt_cleanup( &header_loaded );
+  vt_cleanup( &header_map );
+  remove( path );
+}
+
+void test_map_huge_pages( void )
+{
+  // A low threshold ensures that tables switch from calloc to mapped pages as they grow.
+  vt_huge_page_ctx ctx = { 4096 };
+
+  // Test that both kinds of allocation are zeroed and that mapped allocations are aligned to huge-page boundaries.
+  unsigned char *small = (unsigned char *)vt_huge_page_malloc( 100, &ctx );
+  unsigned char *large = (unsigned char *)vt_huge_page_malloc( 10000, &ctx );
+  ALWAYS_ASSERT( small && large );
+  ALWAYS_ASSERT( (uintptr_t)large % VT_HUGE_PAGE_SIZE == 0 );
+  for( size_t i = 0; i < 10000; ++i )
+    ALWAYS_ASSERT( ( i >= 100 || !small[ i ] ) && !large[ i ] );
+
+  vt_huge_page_free( small, 100, &ctx );
+  vt_huge_page_free( large, 10000, &ctx );
+
+  huge_page_integer_map our_map;
+  vt_init( &our_map, ctx );
+
+  // Test insert, which grows the table from allocated to mapped buckets arrays.
+  for( uint64_t i = 0; i < 10000; ++i )
+    ALWAYS_ASSERT( !vt_is_end( vt_insert( &our_map, i, i + 1 ) ) );
+
+  ALWAYS_ASSERT( vt_size( &our_map ) == 10000 );
+  for( uint64_t i = 0; i < 10000; ++i )
+  {
+    huge_page_integer_map_itr itr = vt_get( &our_map, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->val == i + 1 );
+  }
+
+  // Test erase and shrink, which returns the table to an allocated buckets array.
+  for( uint64_t i = 0; i < 10000; ++i )
+    if( i >= 100 )
+      ALWAYS_ASSERT( vt_erase( &our_map, i ) );
+
+  ALWAYS_ASSERT( vt_shrink( &our_map ) );
+  ALWAYS_ASSERT( vt_size( &our_map ) == 100 );
+  for( uint64_t i = 0; i < 10000; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_map, i ) ) == ( i >= 100 ) );
+
+  // Test reuse after cleanup.
+  vt_cleanup( &our_map );
+  ALWAYS_ASSERT( vt_reserve( &our_map, 10000 ) );
+  ALWAYS_ASSERT( vt_size( &our_map ) == 0 && vt_is_end( vt_first( &our_map ) ) );
+  vt_cleanup( &our_map );
+}
+
+// Set tests.
+
+void test_set_reserve( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  // Reserve zero with placeholder.
+  UNTIL_SUCCESS( vt_reserve( &our_set, 0 ) );
+  ALWAYS_ASSERT( our_set.metadata == &vt_empty_placeholder_metadatum );
+
+  // Reserve up from placeholder.
+  UNTIL_SUCCESS( vt_reserve( &our_set, 30 ) );
+  ALWAYS_ASSERT( 30 <= vt_bucket_count( &our_set ) * GLOBAL_MAX_LOAD );
+
+  // Reserve same capacity.
+  size_t bucket_count = vt_bucket_count( &our_set );
+  UNTIL_SUCCESS( vt_reserve( &our_set, 30 ) );
+  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == bucket_count );
+
+  // Reserve up from non-placeholder.
+  UNTIL_SUCCESS( vt_reserve( &our_set, 60 ) );
+  ALWAYS_ASSERT( 60 <= vt_bucket_count( &our_set ) * GLOBAL_MAX_LOAD );
+
+  // Reserve lower capacity.
+  bucket_count = vt_bucket_count( &our_set );
+  UNTIL_SUCCESS( vt_reserve( &our_set, 30 ) );
+  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == bucket_count );
+
+  // Test validity through use.
+  for( uint64_t i = 0; i < 60; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  // Check.
+  ALWAYS_ASSERT( vt_size( &our_set ) == 60 );
+  for( uint64_t i = 0; i < 60; ++i )
+  {
+    integer_set_itr itr = vt_get( &our_set, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+  }
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_shrink( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  // Test placeholder.
+  UNTIL_SUCCESS( vt_shrink( &our_set ) );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 0 );
+  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == 0 );
+
+  // Test restoration of placeholder.
+  UNTIL_SUCCESS( vt_reserve( &our_set, 30 ) );
+  UNTIL_SUCCESS( vt_shrink( &our_set ) );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 0 );
+  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == 0 );
+  ALWAYS_ASSERT( our_set.metadata == &vt_empty_placeholder_metadatum );
+
+  // Test shrink same size.
+  UNTIL_SUCCESS( vt_reserve( &our_set, 30 ) );
+  for( uint64_t i = 0; i < 30; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 30 );
+  void *buckets_ptr = (void *)our_set.buckets;
+  size_t bucket_count = vt_bucket_count( &our_set );
+  UNTIL_SUCCESS( vt_shrink( &our_set ) );
+  ALWAYS_ASSERT( (void *)our_set.buckets == buckets_ptr );
+  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == bucket_count );
+
+  // Test shrink down.
+  UNTIL_SUCCESS( vt_reserve( &our_set, 500 ) );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 30 );
+  ALWAYS_ASSERT( 500 <= vt_bucket_count( &our_set ) * GLOBAL_MAX_LOAD );
+  UNTIL_SUCCESS( vt_shrink( &our_set ) );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 30 );
+  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == bucket_count );
+
+  // Check.
+  for( uint64_t i = 0; i < 30; ++i )
+  {
+    integer_set_itr itr = vt_get( &our_set, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+  }
+
+  vt_cleanup( &our_set ); 
+}
+
+void test_set_insert( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  // Insert new.
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_set_itr itr;
+    UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, i ) ) );
+    ALWAYS_ASSERT( itr.data->key == i );
+  }
+
+  // Insert existing.
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_set_itr itr;
+    UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, i) ) );
+    ALWAYS_ASSERT( itr.data->key == i );
+  }
+
+  // Check.
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_set_itr itr;
+    itr = vt_get( &our_set, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+  }
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_get_or_insert( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  // Test insert.
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_set_itr itr;
+    UNTIL_SUCCESS( !vt_is_end( itr = vt_get_or_insert( &our_set, i ) ) );
+    ALWAYS_ASSERT( itr.data->key == i );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 100 );
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_set_itr itr = vt_get( &our_set, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+  }
+
+  // Test get.
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_set_itr itr_1 = vt_get( &our_set, i );
+    ALWAYS_ASSERT( !vt_is_end( itr_1 ) );
+    integer_set_itr itr_2;
+    UNTIL_SUCCESS( !vt_is_end( itr_2 = vt_get_or_insert( &our_set, i ) ) );
+    ALWAYS_ASSERT( itr_2.data == itr_1.data && itr_2.data->key == i );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 100 );
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_emplace( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  // Test insert.
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_set_itr itr;
+    bool inserted = false;
+    UNTIL_SUCCESS( !vt_is_end( itr = integer_set_emplace( &our_set, i, &inserted ) ) );
+    ALWAYS_ASSERT( inserted && itr.data->key == i );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 100 );
+
+  // Test get.
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_set_itr itr_1 = vt_get( &our_set, i );
+    integer_set_itr itr_2;
+    bool inserted = true;
+    UNTIL_SUCCESS( !vt_is_end( itr_2 = integer_set_emplace( &our_set, i, &inserted ) ) );
+    ALWAYS_ASSERT( !inserted && itr_2.data == itr_1.data && itr_2.data->key == i );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 100 );
+
+  vt_cleanup( &our_set );
+}
+
+// Constructor for NAME_get_or_insert_lazy that counts its calls and fails for odd keys.
+bool construct_even_key( uint64_t *key, void *user )
+{
+  ++*(size_t *)user;
+  return *key % 2 == 0;
+}
+
+void test_set_get_or_insert_lazy( void )
+{
+  integer_dtors_set our_set;
+  vt_init( &our_set );
+
+  size_t ctor_calls = 0;
+
+  // Test insert, with failed constructions leaving the table unchanged and calling no destructors.
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_dtors_set_itr itr;
+    if( i % 2 )
+    {
+      itr = integer_dtors_set_get_or_insert_lazy( &our_set, i, construct_even_key, &ctor_calls );
+      ALWAYS_ASSERT( vt_is_end( itr ) );
+      ALWAYS_ASSERT( vt_size( &our_set ) == i / 2 + 1 );
+      continue;
+    }
+
+    UNTIL_SUCCESS(
+      !vt_is_end( itr = integer_dtors_set_get_or_insert_lazy( &our_set, i, construct_even_key, &ctor_calls ) )
+    );
+    ALWAYS_ASSERT( itr.data->key == i );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 50 );
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    ALWAYS_ASSERT( !dtor_called[ i ] );
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) == (bool)( i % 2 ) );
+  }
+
+  // Test get, which must not call the constructor.
+  size_t ctor_calls_before_get = ctor_calls;
+  for( uint64_t i = 0; i < 100; i += 2 )
+  {
+    integer_dtors_set_itr itr_1 = vt_get( &our_set, i );
+    integer_dtors_set_itr itr_2 = integer_dtors_set_get_or_insert_lazy( &our_set, i, construct_even_key, &ctor_calls );
+    ALWAYS_ASSERT( itr_2.data == itr_1.data && itr_2.data->key == i );
+  }
+
+  ALWAYS_ASSERT( ctor_calls == ctor_calls_before_get );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 50 );
+
+  // Odd keys were never owned by the table, so only the even keys are destructed.
+  vt_cleanup( &our_set );
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    ALWAYS_ASSERT( dtor_called[ i ] == !( i % 2 ) );
+    dtor_called[ i ] = false;
+  }
+}
+
+void test_set_get( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  // Test empty.
+  for( uint64_t i = 0; i < 100; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) );
+
+  // Test get existing.
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_set_itr itr = vt_get( &our_set, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+  }
+
+  // Test get non-existing.
+  for( uint64_t i = 100; i < 200; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) );
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_get_batch( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  uint64_t keys[ 200 ];
+  integer_set_itr itrs[ 200 ];
+  for( uint64_t i = 0; i < 200; ++i )
+    keys[ i ] = i;
+
+  // Test empty.
+  vt_get_batch( &our_set, keys, 200, itrs );
+  for( uint64_t i = 0; i < 200; ++i )
+    ALWAYS_ASSERT( vt_is_end( itrs[ i ] ) );
+
+  // Test zero keys.
+  vt_get_batch( &our_set, keys, 0, itrs );
+
+  // Test mix of existing and non-existing.
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  vt_get_batch( &our_set, keys, 200, itrs );
+  for( uint64_t i = 0; i < 200; ++i )
+  {
+    if( i < 100 )
+      ALWAYS_ASSERT( !vt_is_end( itrs[ i ] ) && itrs[ i ].data->key == i );
+    else
+      ALWAYS_ASSERT( vt_is_end( itrs[ i ] ) );
+  }
+
+  // Test fewer keys than the prefetch distance.
+  vt_get_batch( &our_set, keys + 95, 10, itrs );
+  for( uint64_t i = 0; i < 10; ++i )
+  {
+    if( i < 5 )
+      ALWAYS_ASSERT( !vt_is_end( itrs[ i ] ) && itrs[ i ].data->key == i + 95 );
+    else
+      ALWAYS_ASSERT( vt_is_end( itrs[ i ] ) );
+  }
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_insert_n( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  uint64_t keys[ 600 ];
+  for( uint64_t i = 0; i < 600; ++i )
+    keys[ i ] = i % 300;
+
+  // Test zero keys.
+  ALWAYS_ASSERT( vt_insert_n( &our_set, keys, 0 ) == 0 );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 0 );
+
+  // Test insert new and duplicates within the batch.
+  for( size_t inserted = 0; inserted < 600; )
+    inserted += vt_insert_n( &our_set, keys + inserted, 600 - inserted );
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 300 );
+  for( uint64_t i = 0; i < 300; ++i )
+    ALWAYS_ASSERT( !vt_is_end( vt_get( &our_set, i ) ) );
+
+  // Test replace existing (fewer keys than the prefetch distance).
+  for( size_t inserted = 0; inserted < 10; )
+    inserted += vt_insert_n( &our_set, keys + inserted, 10 - inserted );
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 300 );
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_erase_n( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  // The batch contains each key in 50-199 twice, interleaved.
+  uint64_t keys[ 300 ];
+  for( uint64_t i = 0; i < 300; ++i )
+    keys[ i ] = 50 + i % 150;
+
+  // Test empty.
+  ALWAYS_ASSERT( vt_erase_n( &our_set, keys, 300 ) == 0 );
+
+  for( uint64_t i = 0; i < 150; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  // Test zero keys.
+  ALWAYS_ASSERT( vt_erase_n( &our_set, keys, 0 ) == 0 );
+
+  // Test mix of existing, non-existing, and duplicates within the batch.
+  ALWAYS_ASSERT( vt_erase_n( &our_set, keys, 300 ) == 100 );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 50 );
+  for( uint64_t i = 0; i < 150; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) == ( i >= 50 ) );
+
+  // Test fewer keys than the prefetch distance.
+  uint64_t few_keys[ 10 ];
+  for( uint64_t i = 0; i < 10; ++i )
+    few_keys[ i ] = i + 45;
+
+  ALWAYS_ASSERT( vt_erase_n( &our_set, few_keys, 10 ) == 5 );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 45 );
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_with_hash( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  // Insert new and existing.
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_set_itr itr;
+    UNTIL_SUCCESS( !vt_is_end( itr = vt_insert_with_hash( &our_set, i, vt_hash_integer( i ) ) ) );
+    ALWAYS_ASSERT( itr.data->key == i );
+    UNTIL_SUCCESS( !vt_is_end( itr = vt_insert_with_hash( &our_set, i, vt_hash_integer( i ) ) ) );
+    ALWAYS_ASSERT( itr.data->key == i );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 100 );
+
+  // Get or insert.
+  for( uint64_t i = 0; i < 200; ++i )
+  {
+    integer_set_itr itr;
+    UNTIL_SUCCESS( !vt_is_end( itr = vt_get_or_insert_with_hash( &our_set, i, vt_hash_integer( i ) ) ) );
+    ALWAYS_ASSERT( itr.data->key == i );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 200 );
+
+  // Erase.
+  for( uint64_t i = 0; i < 200; i += 2 )
+    ALWAYS_ASSERT( vt_erase_with_hash( &our_set, i, vt_hash_integer( i ) ) );
+
+  for( uint64_t i = 0; i < 200; i += 2 )
+    ALWAYS_ASSERT( !vt_erase_with_hash( &our_set, i, vt_hash_integer( i ) ) );
+
+  // Check, using both the hash and non-hash lookup functions.
+  ALWAYS_ASSERT( vt_size( &our_set ) == 100 );
+  for( uint64_t i = 0; i < 200; ++i )
+  {
+    integer_set_itr itr_1 = vt_get_with_hash( &our_set, i, vt_hash_integer( i ) );
+    integer_set_itr itr_2 = vt_get( &our_set, i );
+    ALWAYS_ASSERT( itr_1.data == itr_2.data );
+    if( i % 2 == 0 )
+      ALWAYS_ASSERT( vt_is_end( itr_1 ) );
+    else
+      ALWAYS_ASSERT( !vt_is_end( itr_1 ) && itr_1.data->key == i );
+  }
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_erase( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  // Test erase existing.
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 100 );
+
+  for( uint64_t i = 0; i < 100; i += 2 )
+    ALWAYS_ASSERT( vt_erase( &our_set, i ) );
+
+  // Test erase non-existing.
+  for( uint64_t i = 0; i < 100; i += 2 )
+    ALWAYS_ASSERT( !vt_erase( &our_set, i ) );
+
+  // Check.
+  ALWAYS_ASSERT( vt_size( &our_set ) == 50 );
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    if( i % 2 == 0 )
+      ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) );
+    else
+    {
+      integer_set_itr itr = vt_get( &our_set, i );
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    }
+  }
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_erase_itr( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  // In this instance, the key count and order of insert have been carefully chosen to cause skipped or repeat-visted
+  // keys if vt_erase_itr does not correctly handle the case of another key being moved to the bucket of the erased key.
+  for( int i = 119; i >= 0; --i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 120 );
+
+  // Test with iterator from get.
+  for( uint64_t i = 0; i < 120; i += 4 )
+    vt_erase_itr( &our_set, vt_get( &our_set, i ) );
+
+  // Check.
+  ALWAYS_ASSERT( vt_size( &our_set ) == 90 );
+  for( uint64_t i = 0; i < 120; ++i )
+  {
+    if( i % 4 == 0 )
+      ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) );
+    else
+    {
+      integer_set_itr itr = vt_get( &our_set, i );
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    }
+  }
+
+  // Test deletion while iterating.
+  integer_set_itr itr = vt_first( &our_set );
+  size_t n_iterations = 0;
+  while( !vt_is_end( itr ) )
+  {
+    ++n_iterations;
+
+    if( itr.data->key % 2 == 0 )
+      itr = vt_erase_itr( &our_set, itr );
+    else
+      itr = vt_next( itr );
+  }
+
+  ALWAYS_ASSERT( n_iterations == 90 );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 60 );
+
+  for( uint64_t i = 0; i < 120; ++i )
+  {
+    if( i % 2 == 0 )
+      ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) );
+    else
+    {
+      itr = vt_get( &our_set, i );
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    }
+  }
+
+  vt_cleanup( &our_set );
+}
+
+// Predicate for NAME_erase_if that selects keys divisible by the divisor pointed to by ctx.
+bool set_key_is_multiple( uint64_t *key, void *ctx )
+{
+  return *key % *(uint64_t *)ctx == 0;
+}
+
+void test_set_erase_if( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  // Test empty.
+  uint64_t divisor = 2;
+  ALWAYS_ASSERT( vt_erase_if( &our_set, set_key_is_multiple, &divisor ) == 0 );
+
+  // Erase keys divisible by 2, 3, and 5 in turn, checking after each sweep that the chains remain intact by finding
+  // every surviving key and then reinserting the erased keys.
+  for( uint64_t i = 0; i < 3000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  uint64_t divisors[] = { 2, 3, 5 };
+  for( size_t d = 0; d < 3; ++d )
+  {
+    ALWAYS_ASSERT( vt_erase_if( &our_set, set_key_is_multiple, &divisors[ d ] ) == 3000 / divisors[ d ] );
+    ALWAYS_ASSERT( vt_size( &our_set ) == 3000 - 3000 / divisors[ d ] );
+
+    for( uint64_t i = 0; i < 3000; ++i )
+      ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) == ( i % divisors[ d ] == 0 ) );
+
+    for( uint64_t i = 0; i < 3000; i += divisors[ d ] )
+      UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+    ALWAYS_ASSERT( vt_size( &our_set ) == 3000 );
+  }
+
+  // Test erasing all keys.
+  divisor = 1;
+  ALWAYS_ASSERT( vt_erase_if( &our_set, set_key_is_multiple, &divisor ) == 3000 );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 0 && vt_is_end( vt_first( &our_set ) ) );
+
+  vt_cleanup( &our_set );
+
+  // Test that the destructor is called on exactly the erased keys.
+  integer_dtors_set dtors_set;
+  vt_init( &dtors_set );
+
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &dtors_set, i ) ) );
+
+  divisor = 2;
+  ALWAYS_ASSERT( vt_erase_if( &dtors_set, set_key_is_multiple, &divisor ) == 50 );
+  for( uint64_t i = 0; i < 100; ++i )
+    ALWAYS_ASSERT( dtor_called[ i ] == ( i % 2 == 0 ) );
+
+  vt_cleanup( &dtors_set );
+  check_dtors_arr();
+
+  // Test the concurrent variant.
+  shard_integer_set_concurrent shard_set;
+  ALWAYS_ASSERT( shard_integer_set_concurrent_init( &shard_set ) );
+
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( shard_integer_set_concurrent_insert( &shard_set, i ) );
+
+  divisor = 4;
+  ALWAYS_ASSERT( shard_integer_set_concurrent_erase_if( &shard_set, set_key_is_multiple, &divisor ) == 250 );
+  ALWAYS_ASSERT( shard_integer_set_concurrent_size( &shard_set ) == 750 );
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( shard_integer_set_concurrent_get( &shard_set, i ) == ( i % 4 != 0 ) );
+
+  shard_integer_set_concurrent_cleanup( &shard_set );
+}
+
+void test_set_clear( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  // Test empty.
+  vt_clear( &our_set );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 0 );
+
+  // Test non-empty;
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  vt_clear( &our_set );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 0 );
+  for( uint64_t i = 0; i < 100; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) );
+
+  // Test reuse.
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_set_itr itr = vt_get( &our_set, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+  }
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_cleanup( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  // Empty.
+  vt_cleanup( &our_set );
+  ALWAYS_ASSERT( our_set.metadata == &vt_empty_placeholder_metadatum );
+
+  // Non-empty.
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 100 );
+  vt_cleanup( &our_set );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 0 );
+  ALWAYS_ASSERT( our_set.metadata == &vt_empty_placeholder_metadatum );
+
+  // Test use.
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+  for( uint64_t i = 0; i < 100; ++i )
+  {
+    integer_set_itr itr = vt_get( &our_set, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+  }
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_init_clone( void )
+{
+  integer_set src_set;
+  vt_init( &src_set );
+
+  // Test init_clone placeholder.
+  integer_set empty_set;
+  UNTIL_SUCCESS( vt_init_clone( &empty_set, &src_set ) );
+  ALWAYS_ASSERT( empty_set.metadata == &vt_empty_placeholder_metadatum );
+
+  // Test init_clone non-placeholder.
+  integer_set our_set;
+  for( uint64_t i = 0; i < 10; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &src_set, i ) ) );
+  UNTIL_SUCCESS( vt_init_clone( &our_set, &src_set ) );
+
+  // Check.
+  ALWAYS_ASSERT( vt_size( &our_set ) == 10 );
+  for( uint64_t i = 0; i < 10; ++i )
+  {
+    integer_set_itr itr = vt_get( &our_set, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+  }
+
+  vt_cleanup( &src_set );
+  vt_cleanup( &empty_set );
+  vt_cleanup( &our_set );
+}
+
+void test_set_set_operations( void )
+{
+  // a contains keys 0 to 999, and b contains keys 500 to 1999.
+  integer_set a;
+  integer_set b;
+  vt_init( &a );
+  vt_init( &b );
+
+  // Test empty.
+  integer_set out;
+  vt_init( &out );
+  UNTIL_SUCCESS( vt_intersect( &out, &a, &b ) );
+  UNTIL_SUCCESS( vt_union_into( &out, &a ) );
+  UNTIL_SUCCESS( vt_difference( &out, &a, &b ) );
+  ALWAYS_ASSERT( vt_size( &out ) == 0 );
+
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &a, i ) ) );
+
+  for( uint64_t i = 500; i < 2000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &b, i ) ) );
+
+  // Test intersect, iterating over a and then over b.
+  UNTIL_SUCCESS( vt_intersect( &out, &a, &b ) );
+  ALWAYS_ASSERT( vt_size( &out ) == 500 );
+  for( uint64_t i = 0; i < 2000; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &out, i ) ) == ( i < 500 || i >= 1000 ) );
+
+  vt_clear( &out );
+  UNTIL_SUCCESS( vt_intersect( &out, &b, &a ) );
+  ALWAYS_ASSERT( vt_size( &out ) == 500 );
+  for( uint64_t i = 500; i < 1000; ++i )
+    ALWAYS_ASSERT( !vt_is_end( vt_get( &out, i ) ) );
+
+  // Test difference.
+  vt_clear( &out );
+  UNTIL_SUCCESS( vt_difference( &out, &b, &a ) );
+  ALWAYS_ASSERT( vt_size( &out ) == 1000 );
+  for( uint64_t i = 0; i < 2000; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &out, i ) ) == ( i < 1000 ) );
+
+  // Test union_into.
+  UNTIL_SUCCESS( vt_union_into( &out, &a ) );
+  ALWAYS_ASSERT( vt_size( &out ) == 2000 );
+  for( uint64_t i = 0; i < 2000; ++i )
+    ALWAYS_ASSERT( !vt_is_end( vt_get( &out, i ) ) );
+
+  vt_cleanup( &out );
+  vt_cleanup( &b );
+  vt_cleanup( &a );
+
+  // Test that stored hash codes are reused rather than recomputed.
+  integer_set_with_stored_hash stored_a;
+  integer_set_with_stored_hash stored_b;
+  integer_set_with_stored_hash stored_out;
+  vt_init( &stored_a );
+  vt_init( &stored_b );
+  vt_init( &stored_out );
+
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &stored_a, i ) ) );
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &stored_b, i * 2 ) ) );
+  }
+
+  hash_calls = 0;
+  UNTIL_SUCCESS( vt_difference( &stored_out, &stored_a, &stored_b ) );
+  ALWAYS_ASSERT( vt_size( &stored_out ) == 500 && hash_calls == 0 );
+
+  vt_cleanup( &stored_out );
+  vt_cleanup( &stored_b );
+  vt_cleanup( &stored_a );
+}
+
+void test_set_iteration( void )
+{
+  integer_set our_set;
+  vt_init( &our_set );
+
+  // Empty.
+
+  // Test fist.
+  ALWAYS_ASSERT( vt_is_end( vt_first( &our_set ) ) );
+
+  size_t n_iterations = 0;
+
+  for(
+    integer_set_itr itr = vt_first( &our_set );
+    !vt_is_end( itr );
+    itr = vt_next( itr )
+  )
+    ++n_iterations;
+
+  ALWAYS_ASSERT( n_iterations == 0 );
+
+  // Non-empty.
+  for( uint64_t i = 0; i < 30; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  for(
+    integer_set_itr itr = vt_first( &our_set );
+    !vt_is_end( itr );
+    itr = vt_next( itr )
+  )
+    ++n_iterations;
+
+  ALWAYS_ASSERT( n_iterations == 30 );
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_dtors( void )
+{
+  integer_dtors_set our_set;
+  integer_dtors_set_init( &our_set );
+
+  // Test erase and clear.
+
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !integer_dtors_set_is_end( integer_dtors_set_insert( &our_set, i ) ) );
+
+  for( uint64_t i = 0; i < 100; i += 2 ) // TODO: Fix in CC
+    integer_dtors_set_erase( &our_set, i );
+
+  integer_dtors_set_clear( &our_set );
+
+  check_dtors_arr();
+
+  // Test replace.
+
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !integer_dtors_set_is_end( integer_dtors_set_insert( &our_set, i ) ) );
+
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !integer_dtors_set_is_end( integer_dtors_set_insert( &our_set, i ) ) );
 
   check_dtors_arr();
   integer_dtors_set_clear( &our_set );
 
-  // Test cleanup.
+  // Test cleanup.
+
+  for( uint64_t i = 0; i < 100; ++i )
+    UNTIL_SUCCESS( !integer_dtors_set_is_end( integer_dtors_set_insert( &our_set, i ) ) );
+
+  integer_dtors_set_cleanup( &our_set );
+  check_dtors_arr();
+}
+
+void test_set_strings( void )
+{
+  string_set our_set;
+  vt_init( &our_set );
+
+  string_set_itr itr;
+
+  // String literals.
+  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, "This" ) ) );
+  ALWAYS_ASSERT( strcmp( itr.data->key, "This" ) == 0 );
+  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, "is" ) ) );
+  ALWAYS_ASSERT( strcmp( itr.data->key, "is" ) == 0 );
+  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, "a" ) ) );
+  ALWAYS_ASSERT( strcmp( itr.data->key, "a" ) == 0 );
+  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, "test" ) ) );
+  ALWAYS_ASSERT( strcmp( itr.data->key, "test" ) == 0 );
+
+  // Other strings.
+  char str_1[] = "of";
+  char str_2[] = "sets";
+  char str_3[] = "with";
+  char str_4[] = "strings";
+
+  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, str_1 ) ) );
+  ALWAYS_ASSERT( strcmp( itr.data->key, str_1 ) == 0 );
+  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, str_2 ) ) );
+  ALWAYS_ASSERT( strcmp( itr.data->key, str_2 ) == 0 );
+  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, str_3 ) ) );
+  ALWAYS_ASSERT( strcmp( itr.data->key, str_3 ) == 0 );
+  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, str_4 ) ) );
+  ALWAYS_ASSERT( strcmp( itr.data->key, str_4 ) == 0 );
+
+  // Check.
+  ALWAYS_ASSERT( vt_size( &our_set ) == 8 );
+  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "This" ).data->key, "This" ) == 0 );
+  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "is" ).data->key, "is" ) == 0 );
+  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "a" ).data->key, "a" ) == 0 );
+  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "test" ).data->key, "test" ) == 0 );
+  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "of" ).data->key, str_1 ) == 0 );
+  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "sets" ).data->key, str_2 ) == 0 );
+  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "with" ).data->key, str_3 ) == 0 );
+  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "strings" ).data->key, str_4 ) == 0 );
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_lookup_key( void )
+{
+  static char keys[ 1000 ][ 8 ];
+  static char buffer[ 1000 * 8 ];
+  size_t offsets[ 1001 ];
+  offsets[ 0 ] = 0;
+  for( size_t i = 0; i < 1000; ++i )
+  {
+    sprintf( keys[ i ], "k%zu", i );
+    memcpy( buffer + offsets[ i ], keys[ i ], strlen( keys[ i ] ) );
+    offsets[ i + 1 ] = offsets[ i ] + strlen( keys[ i ] );
+  }
+
+  string_set_with_lookup our_set;
+  vt_init( &our_set );
+
+  string_slice first_slice = { buffer, offsets[ 1 ] };
+  ALWAYS_ASSERT( vt_is_end( string_set_with_lookup_get_by( &our_set, first_slice ) ) );
+  ALWAYS_ASSERT( !string_set_with_lookup_erase_by( &our_set, first_slice ) );
+
+  for( size_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, keys[ i ] ) ) );
+
+  for( size_t i = 0; i < 1000; ++i )
+  {
+    string_slice slice = { buffer + offsets[ i ], offsets[ i + 1 ] - offsets[ i ] };
+    string_set_with_lookup_itr itr = string_set_with_lookup_get_by( &our_set, slice );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == keys[ i ] );
+
+    ++slice.len;
+    ALWAYS_ASSERT( vt_is_end( string_set_with_lookup_get_by( &our_set, slice ) ) );
+  }
+
+  for( size_t i = 0; i < 1000; i += 2 )
+  {
+    string_slice slice = { buffer + offsets[ i ], offsets[ i + 1 ] - offsets[ i ] };
+    ALWAYS_ASSERT( string_set_with_lookup_erase_by( &our_set, slice ) );
+    ALWAYS_ASSERT( !string_set_with_lookup_erase_by( &our_set, slice ) );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 500 );
+  for( size_t i = 0; i < 1000; ++i )
+  {
+    string_slice slice = { buffer + offsets[ i ], offsets[ i + 1 ] - offsets[ i ] };
+    ALWAYS_ASSERT( vt_is_end( string_set_with_lookup_get_by( &our_set, slice ) ) == ( i % 2 == 0 ) );
+  }
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_sso_strings( void )
+{
+  sso_string_set our_set;
+  vt_init( &our_set );
+
+  char buffer[ 64 ];
+  for( size_t i = 0; i < 1000; ++i )
+  {
+    vt_sso_string key;
+    ALWAYS_ASSERT( vt_sso_string_init( &key, buffer, write_padded_key( buffer, i ) ) );
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, key ) ) );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 1000 );
+
+  for( size_t i = 0; i < 1000; ++i )
+  {
+    size_t len = write_padded_key( buffer, i );
+    vt_sso_string borrowed;
+    ALWAYS_ASSERT( vt_sso_string_borrow( &borrowed, buffer, len ) );
+    sso_string_set_itr itr = vt_get( &our_set, borrowed );
+    ALWAYS_ASSERT( !vt_is_end( itr ) );
+    ALWAYS_ASSERT( itr.data->key.len == len && memcmp( vt_sso_string_chars( &itr.data->key ), buffer, len + 1 ) == 0 );
+
+    buffer[ len - 1 ] = 'x';
+    ALWAYS_ASSERT( vt_sso_string_borrow( &borrowed, buffer, len ) );
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, borrowed ) ) );
+  }
+
+  for( size_t i = 0; i < 1000; i += 2 )
+  {
+    vt_sso_string borrowed;
+    ALWAYS_ASSERT( vt_sso_string_borrow( &borrowed, buffer, write_padded_key( buffer, i ) ) );
+    ALWAYS_ASSERT( vt_erase( &our_set, borrowed ) );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 500 );
+  for( size_t i = 0; i < 1000; ++i )
+  {
+    vt_sso_string borrowed;
+    ALWAYS_ASSERT( vt_sso_string_borrow( &borrowed, buffer, write_padded_key( buffer, i ) ) );
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, borrowed ) ) == ( i % 2 == 0 ) );
+  }
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_with_ctx( void )
+{
+  integer_set_with_ctx our_sets[ 10 ];
+  integer_set_with_ctx our_set_clones[ 10 ];
+
+  for( size_t i = 0; i < 10; ++i )
+  {
+    // Initializing the ctx member on init.
+    context ctx = { i, 0 };
+    vt_init( &our_sets[ i ], ctx );
+    ALWAYS_ASSERT( our_sets[ i ].ctx.id == i );
+
+    // Conveying ctx during rehashes.
+
+    for( size_t j = 0; j < 100; ++j )
+      UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_sets[ i ], j ) ) );
+
+    for( size_t j = 0; j < 50; ++j )
+      vt_erase( &our_sets[ i ], j );
+
+    UNTIL_SUCCESS( vt_shrink( &our_sets[ i ] ) );
+    
+    ALWAYS_ASSERT( our_sets[ i ].ctx.id == i );
+
+    // Initializing the ctx member on init_clone.
+
+    UNTIL_SUCCESS( vt_init_clone( &our_set_clones[ i ], &our_sets[ i ], our_sets[ i ].ctx ) );
+    ALWAYS_ASSERT( our_set_clones[ i ].ctx.id == i );
+
+    for( size_t j = 50; j < 100; ++j )
+      UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set_clones[ i ], j ) ) );
+
+    vt_cleanup( &our_sets[ i ] );
+    vt_cleanup( &our_set_clones[ i ] );
+  }
+}
+
+void test_set_with_stored_hash( void )
+{
+  integer_set_with_stored_hash our_set;
+  vt_init( &our_set );
+
+  // Each insertion should hash only the new key, even though the table is rehashed many times and keys are evicted.
+  hash_calls = 0;
+  size_t expected_hash_calls = 0;
+  for( uint64_t i = 0; i < 500; ++i )
+  {
+    integer_set_with_stored_hash_itr itr;
+    UNTIL_SUCCESS( ( ++expected_hash_calls, !vt_is_end( itr = vt_insert( &our_set, i ) ) ) );
+    ALWAYS_ASSERT( itr.data->hash == vt_hash_integer( i ) );
+  }
+
+  ALWAYS_ASSERT( hash_calls == expected_hash_calls );
+
+  // Erasing during iteration, where the home bucket of each key is unknown, and shrinking should not hash any keys.
+  for(
+    integer_set_with_stored_hash_itr itr = vt_first( &our_set );
+    !vt_is_end( itr );
+  )
+  {
+    if( itr.data->key % 2 == 0 )
+      itr = vt_erase_itr( &our_set, itr );
+    else
+      itr = vt_next( itr );
+  }
+
+  UNTIL_SUCCESS( vt_shrink( &our_set ) );
+  ALWAYS_ASSERT( hash_calls == expected_hash_calls );
+
+  // Check.
+  ALWAYS_ASSERT( vt_size( &our_set ) == 250 );
+  for( uint64_t i = 0; i < 500; ++i )
+  {
+    integer_set_with_stored_hash_itr itr = vt_get( &our_set, i );
+    if( i % 2 == 0 )
+      ALWAYS_ASSERT( vt_is_end( itr ) );
+    else
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i && itr.data->hash == vt_hash_integer( i ) );
+  }
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_metadata_32( void )
+{
+  vt_table_stats stats;
+
+  integer_set_with_metadata_32 our_set;
+  vt_init( &our_set );
+
+  // As in the map test, these keys share a 4-bit hash-code fragment but not a 12-bit one.
+  for( uint64_t i = 0; i < 200; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i << 52 ) ) );
+
+  for( uint64_t i = 0; i < 200; ++i )
+    ALWAYS_ASSERT( !vt_is_end( vt_get( &our_set, i << 52 ) ) );
+
+  vt_stats( &our_set, &stats );
+  ALWAYS_ASSERT( stats.chain_count == 1 && stats.max_chain_length == 200 );
+  ALWAYS_ASSERT( stats.hashfrag_pair_count == 200 * 199 / 2 && stats.hashfrag_collision_count == 0 );
+  ALWAYS_ASSERT( stats.counters.cmpr_mismatches == 0 );
+
+  // Force a key beyond the 11-bit displacement limit.
+  vt_clear( &our_set );
+  UNTIL_SUCCESS( vt_reserve( &our_set, 3000 ) );
+  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == 4096 );
+
+  for( uint64_t i = 0; i <= VT_DISPLACEMENT_MASK; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, ( i * i + i ) / 2 % 4096 ) ) );
+
+  UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, 4096 ) ) );
+
+  vt_stats( &our_set, &stats );
+  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == 4096 );
+  ALWAYS_ASSERT( stats.max_displacement == VT_DISPLACEMENT_MASK + 1 );
+  ALWAYS_ASSERT( stats.counters.displacement_limit_rehashes == 0 );
+
+  // Erase every other key during iteration.
+  size_t n_iterations = 0;
+  for( integer_set_with_metadata_32_itr itr = vt_first( &our_set ); !vt_is_end( itr ); ++n_iterations )
+  {
+    if( itr.data->key % 2 == 0 )
+      itr = vt_erase_itr( &our_set, itr );
+    else
+      itr = vt_next( itr );
+  }
+
+  ALWAYS_ASSERT( n_iterations == VT_DISPLACEMENT_MASK + 2 );
+
+  // Check.
+  for( uint64_t i = 0; i <= VT_DISPLACEMENT_MASK; ++i )
+  {
+    uint64_t key = ( i * i + i ) / 2 % 4096;
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, key ) ) == ( key % 2 == 0 ) );
+  }
+
+  ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, 4096 ) ) );
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_ordered( void )
+{
+  integer_set_ordered our_set;
+  vt_init( &our_set );
+
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, ordered_key( i ) ) ) );
+
+  // Iteration follows the insertion order.
+  // Erase every other key during iteration.
+  uint64_t n_iterations = 0;
+  for( integer_set_ordered_itr itr = vt_first( &our_set ); !vt_is_end( itr ); ++n_iterations )
+  {
+    ALWAYS_ASSERT( itr.data->key == ordered_key( n_iterations ) );
+    if( n_iterations % 2 == 0 )
+      itr = vt_erase_itr( &our_set, itr );
+    else
+      itr = vt_next( itr );
+  }
+
+  ALWAYS_ASSERT( n_iterations == 1000 );
+
+  // Grow the table, which closes the gaps left by the erased keys without changing the order.
+  for( uint64_t i = 1000; i < 3000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  n_iterations = 0;
+  for( integer_set_ordered_itr itr = vt_first( &our_set ); !vt_is_end( itr ); itr = vt_next( itr ), ++n_iterations )
+  {
+    if( n_iterations < 500 )
+      ALWAYS_ASSERT( itr.data->key == ordered_key( n_iterations * 2 + 1 ) );
+    else
+      ALWAYS_ASSERT( itr.data->key == n_iterations - 500 + 1000 );
+  }
+
+  ALWAYS_ASSERT( n_iterations == 2500 && vt_size( &our_set ) == 2500 );
+
+  // Erasing the most recently inserted keys and inserting others in their place should not grow the table.
+  size_t bucket_count = vt_bucket_count( &our_set );
+  for( uint64_t i = 0; i < 10000; ++i )
+  {
+    ALWAYS_ASSERT( vt_erase( &our_set, 2999 ) );
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, 2999 ) ) );
+  }
+
+  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == bucket_count );
+
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, ordered_key( i ) ) ) == ( i % 2 == 0 ) );
+
+  vt_cleanup( &our_set );
+}
+
+void test_set_incremental_rehash( void )
+{
+  integer_set_incremental our_set;
+  vt_init( &our_set );
+
+  // Insert keys until an incremental rehash of a buckets array with at least 256 buckets is in progress.
+  uint64_t n = 0;
+  while( our_set.old_buckets_mask < 255 )
+  {
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, n ) ) );
+    ++n;
+  }
+
+  // Keys should now be split between the old and new buckets arrays.
+  ALWAYS_ASSERT( vt_size( &our_set ) == n );
+  ALWAYS_ASSERT( our_set.old_key_count > 0 && our_set.old_key_count < n );
+
+  // Lookups and iteration, which do not advance the rehash, should find every key.
+  for( uint64_t i = 0; i < n + 100; ++i )
+  {
+    integer_set_incremental_itr itr = vt_get( &our_set, i );
+    if( i < n )
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    else
+      ALWAYS_ASSERT( vt_is_end( itr ) );
+  }
+
+  size_t old_key_count = our_set.old_key_count;
+  uint64_t key_sum = 0;
+  size_t n_iterations = 0;
+  for( integer_set_incremental_itr itr = vt_first( &our_set ); !vt_is_end( itr ); itr = vt_next( itr ) )
+  {
+    key_sum += itr.data->key;
+    ++n_iterations;
+  }
+
+  ALWAYS_ASSERT( n_iterations == n && key_sum == n * ( n - 1 ) / 2 );
+  ALWAYS_ASSERT( our_set.old_key_count == old_key_count );
+
+  // Cloning should copy both buckets arrays.
+  integer_set_incremental clone;
+  UNTIL_SUCCESS( vt_init_clone( &clone, &our_set ) );
+  ALWAYS_ASSERT( vt_size( &clone ) == n && clone.old_key_count == old_key_count );
+  for( uint64_t i = 0; i < n; ++i )
+    ALWAYS_ASSERT( !vt_is_end( vt_get( &clone, i ) ) );
+
+  vt_cleanup( &clone );
+
+  // Re-inserting existing keys should find them in either buckets array and advance the rehash.
+  for( uint64_t i = 0; i + 1 < n; i += 8 )
+  {
+    integer_set_incremental_itr itr;
+    UNTIL_SUCCESS( !vt_is_end( itr = vt_get_or_insert( &our_set, i ) ) );
+    ALWAYS_ASSERT( itr.data->key == i );
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i + 1 ) ) );
+  }
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == n );
+  ALWAYS_ASSERT( our_set.old_key_count < old_key_count );
+
+  // Erasing during iteration should work across both buckets arrays.
+  n_iterations = 0;
+  integer_set_incremental_itr itr = vt_first( &our_set );
+  while( !vt_is_end( itr ) )
+  {
+    ++n_iterations;
+
+    if( itr.data->key % 2 == 0 )
+      itr = vt_erase_itr( &our_set, itr );
+    else
+      itr = vt_next( itr );
+  }
+
+  ALWAYS_ASSERT( n_iterations == n );
+  ALWAYS_ASSERT( vt_size( &our_set ) == n / 2 );
+
+  // Further insertions and erasures should complete the rehash.
+  for( uint64_t i = n; our_set.old_buckets_mask; ++i )
+  {
+    if( i % 2 == 0 )
+      ALWAYS_ASSERT( !vt_erase( &our_set, i ) );
+    else
+      UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+    if( i >= n * 2 ) // Just in case the above loop fails to finish.
+      ALWAYS_ASSERT( false );
+  }
+
+  ALWAYS_ASSERT( our_set.old_key_count == 0 && !our_set.old_buckets && !our_set.old_metadata );
+
+  // Check.
+  for( uint64_t i = 0; i < n; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) == ( i % 2 == 0 ) );
+
+  // Clearing, shrinking, and cleaning up in the middle of an incremental rehash should free the old buckets array.
+  vt_clear( &our_set );
+  while( !our_set.old_buckets_mask )
+  {
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, n ) ) );
+    ++n;
+  }
+
+  vt_clear( &our_set );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 0 && !our_set.old_buckets_mask );
+
+  while( !our_set.old_buckets_mask )
+  {
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, n ) ) );
+    ++n;
+  }
+
+  UNTIL_SUCCESS( vt_shrink( &our_set ) );
+  ALWAYS_ASSERT( !our_set.old_buckets_mask );
+
+  while( !our_set.old_buckets_mask )
+  {
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, n ) ) );
+    ++n;
+  }
 
-  for( uint64_t i = 0; i < 100; ++i )
-    UNTIL_SUCCESS( !integer_dtors_set_is_end( integer_dtors_set_insert( &our_set, i ) ) );
+  vt_cleanup( &our_set );
+}
 
-  integer_dtors_set_cleanup( &our_set );
-  check_dtors_arr();
+void test_set_stats( void )
+{
+  vt_table_stats stats;
+
+  // Check the internal consistency of the statistics for a table with a good hash function.
+  integer_set our_set;
+  vt_init( &our_set );
+
+  vt_stats( &our_set, &stats );
+  ALWAYS_ASSERT( stats.key_count == 0 && stats.bucket_count == 0 && stats.chain_count == 0 );
+
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  vt_stats( &our_set, &stats );
+  ALWAYS_ASSERT( stats.key_count == 1000 && stats.bucket_count == vt_bucket_count( &our_set ) );
+
+  size_t chain_count = 0;
+  size_t key_count = 0;
+  for( size_t i = 0; i < VT_STATS_HISTOGRAM_LENGTH; ++i )
+  {
+    chain_count += stats.chain_length_histogram[ i ];
+    key_count += stats.displacement_histogram[ i ];
+  }
+
+  ALWAYS_ASSERT( chain_count == stats.chain_count && key_count == 1000 );
+  ALWAYS_ASSERT( stats.chain_length_histogram[ 0 ] == 0 && stats.displacement_histogram[ 0 ] == stats.chain_count );
+  ALWAYS_ASSERT( stats.displaced_key_count == 1000 - stats.chain_count );
+  ALWAYS_ASSERT( stats.displaced_fraction == (double)stats.displaced_key_count / 1000 );
+  ALWAYS_ASSERT( stats.hashfrag_collision_count <= stats.hashfrag_pair_count );
+  ALWAYS_ASSERT( stats.max_chain_length >= 1 && stats.max_displacement < VT_DISPLACEMENT_MASK );
+
+  vt_cleanup( &our_set );
+
+  // Check exact statistics and counters for a table whose layout is predictable.
+  integer_set_with_identity_hash identity_set;
+  vt_init( &identity_set );
+
+  // Keys 0 and 8 both belong to bucket 0 in a table with eight buckets, so 8 is placed in bucket 1.
+  // Inserting 8 calls CMPR_FN on 0, which is a mismatch because the keys share a hash-code fragment.
+  // Key 1 then evicts 8 from bucket 1, so 8 is relocated to bucket 3, two quadratic displacements from bucket 0.
+  for( uint64_t i = 0; i < 3; ++i )
+  {
+    uint64_t key = i == 1 ? 8 : i / 2;
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &identity_set, key ) ) );
+  }
+
+  ALWAYS_ASSERT( vt_bucket_count( &identity_set ) == 8 );
+
+  // Looking up 8 calls CMPR_FN on 0 again.
+  ALWAYS_ASSERT( !vt_is_end( vt_get( &identity_set, 8 ) ) );
+
+  vt_stats( &identity_set, &stats );
+  ALWAYS_ASSERT( stats.key_count == 3 && stats.chain_count == 2 && stats.max_chain_length == 2 );
+  ALWAYS_ASSERT( stats.chain_length_histogram[ 1 ] == 1 && stats.chain_length_histogram[ 2 ] == 1 );
+  ALWAYS_ASSERT( stats.displacement_histogram[ 0 ] == 2 && stats.displacement_histogram[ 2 ] == 1 );
+  ALWAYS_ASSERT( stats.displaced_key_count == 1 && stats.max_displacement == 2 );
+  ALWAYS_ASSERT( stats.hashfrag_pair_count == 1 && stats.hashfrag_collision_count == 1 );
+  ALWAYS_ASSERT( stats.hashfrag_collision_rate == 1.0 );
+  ALWAYS_ASSERT( stats.counters.evictions == 1 );
+  ALWAYS_ASSERT( stats.counters.cmpr_mismatches == 2 );
+  ALWAYS_ASSERT( stats.counters.displacement_limit_rehashes == 0 );
+
+  vt_cleanup( &identity_set );
 }
 
-void test_set_strings( void )
+void test_set_freeze( void )
 {
-  string_set our_set;
+  integer_set our_set;
   vt_init( &our_set );
 
-  string_set_itr itr;
+  integer_set_frozen frozen;
+  UNTIL_SUCCESS( vt_freeze( &our_set, &frozen ) );
+  ALWAYS_ASSERT( vt_frozen_size( &frozen ) == 0 && !vt_frozen_get( &frozen, 0 ) );
+  vt_frozen_cleanup( &frozen );
 
-  // String literals.
-  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, "This" ) ) );
-  ALWAYS_ASSERT( strcmp( itr.data->key, "This" ) == 0 );
-  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, "is" ) ) );
-  ALWAYS_ASSERT( strcmp( itr.data->key, "is" ) == 0 );
-  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, "a" ) ) );
-  ALWAYS_ASSERT( strcmp( itr.data->key, "a" ) == 0 );
-  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, "test" ) ) );
-  ALWAYS_ASSERT( strcmp( itr.data->key, "test" ) == 0 );
+  for( uint64_t i = 0; i < 3000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
 
-  // Other strings.
-  char str_1[] = "of";
-  char str_2[] = "sets";
-  char str_3[] = "with";
-  char str_4[] = "strings";
+  for( uint64_t i = 0; i < 3000; i += 3 )
+    ALWAYS_ASSERT( vt_erase( &our_set, i ) );
 
-  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, str_1 ) ) );
-  ALWAYS_ASSERT( strcmp( itr.data->key, str_1 ) == 0 );
-  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, str_2 ) ) );
-  ALWAYS_ASSERT( strcmp( itr.data->key, str_2 ) == 0 );
-  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, str_3 ) ) );
-  ALWAYS_ASSERT( strcmp( itr.data->key, str_3 ) == 0 );
-  UNTIL_SUCCESS( !vt_is_end( itr = vt_insert( &our_set, str_4 ) ) );
-  ALWAYS_ASSERT( strcmp( itr.data->key, str_4 ) == 0 );
+  UNTIL_SUCCESS( vt_freeze( &our_set, &frozen ) );
+  ALWAYS_ASSERT( vt_frozen_size( &frozen ) == 2000 );
+  vt_clear( &our_set );
 
-  // Check.
-  ALWAYS_ASSERT( vt_size( &our_set ) == 8 );
-  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "This" ).data->key, "This" ) == 0 );
-  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "is" ).data->key, "is" ) == 0 );
-  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "a" ).data->key, "a" ) == 0 );
-  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "test" ).data->key, "test" ) == 0 );
-  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "of" ).data->key, str_1 ) == 0 );
-  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "sets" ).data->key, str_2 ) == 0 );
-  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "with" ).data->key, str_3 ) == 0 );
-  ALWAYS_ASSERT( strcmp( vt_get( &our_set, "strings" ).data->key, str_4 ) == 0 );
+  // 8-byte buckets fit fourteen per two cache lines, so lookups compare each block's fragments in two groups.
+  ALWAYS_ASSERT( integer_set_frozen_line_count == 2 && integer_set_frozen_slot_count == 14 );
+
+  for( uint64_t i = 0; i < 6000; ++i )
+  {
+    const integer_set_bucket *bucket = vt_frozen_get( &frozen, i );
+    ALWAYS_ASSERT( ( bucket && bucket->key == i ) == ( i < 3000 && i % 3 ) );
+  }
 
+  vt_frozen_cleanup( &frozen );
   vt_cleanup( &our_set );
+
+  // Test that freezing a table that stores hash codes reuses them rather than rehashing the keys.
+  integer_set_with_stored_hash stored_hash_set;
+  vt_init( &stored_hash_set );
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &stored_hash_set, i ) ) );
+
+  integer_set_with_stored_hash_frozen stored_hash_frozen;
+  size_t expected_hash_calls = hash_calls;
+  UNTIL_SUCCESS( vt_freeze( &stored_hash_set, &stored_hash_frozen ) );
+  ALWAYS_ASSERT( hash_calls == expected_hash_calls );
+
+  for( uint64_t i = 0; i < 2000; ++i )
+    ALWAYS_ASSERT( !vt_frozen_get( &stored_hash_frozen, i ) == ( i >= 1000 ) );
+
+  vt_frozen_cleanup( &stored_hash_frozen );
+  vt_cleanup( &stored_hash_set );
 }
 
-void test_set_with_ctx( void )
+void test_set_concurrent( void )
 {
-  integer_set_with_ctx our_sets[ 10 ];
-  integer_set_with_ctx our_set_clones[ 10 ];
+  shard_integer_set_concurrent our_set;
+  ALWAYS_ASSERT( shard_integer_set_concurrent_init( &our_set ) );
 
-  for( size_t i = 0; i < 10; ++i )
+  // Insert.
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( shard_integer_set_concurrent_insert( &our_set, i ) );
+
+  ALWAYS_ASSERT( shard_integer_set_concurrent_size( &our_set ) == 1000 );
+
+  // Check that the keys are spread across all shards and that each key is in the shard that its hash code selects.
+  size_t total = 0;
+  for( size_t i = 0; i < 4; ++i )
   {
-    // Initializing the ctx member on init.
-    context ctx = { i, 0 };
-    vt_init( &our_sets[ i ], ctx );
-    ALWAYS_ASSERT( our_sets[ i ].ctx.id == i );
+    ALWAYS_ASSERT( vt_size( &our_set.shards[ i ].table ) > 0 );
+    total += vt_size( &our_set.shards[ i ].table );
+  }
+  ALWAYS_ASSERT( total == 1000 );
 
-    // Conveying ctx during rehashes.
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    size_t shard_index = ( ( vt_hash_integer( i ) >> 32 ) & 0xFFFFF ) % 4;
+    ALWAYS_ASSERT( !vt_is_end( vt_get( &our_set.shards[ shard_index ].table, i ) ) );
+  }
 
-    for( size_t j = 0; j < 100; ++j )
-      UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_sets[ i ], j ) ) );
+  // Get.
+  for( uint64_t i = 0; i < 2000; ++i )
+    ALWAYS_ASSERT( shard_integer_set_concurrent_get( &our_set, i ) == ( i < 1000 ) );
 
-    for( size_t j = 0; j < 50; ++j )
-      vt_erase( &our_sets[ i ], j );
+  // Replace.
+  for( uint64_t i = 0; i < 1000; i += 2 )
+    UNTIL_SUCCESS( shard_integer_set_concurrent_insert( &our_set, i ) );
 
-    UNTIL_SUCCESS( vt_shrink( &our_sets[ i ] ) );
-    
-    ALWAYS_ASSERT( our_sets[ i ].ctx.id == i );
+  ALWAYS_ASSERT( shard_integer_set_concurrent_size( &our_set ) == 1000 );
 
-    // Initializing the ctx member on init_clone.
+  // Erase.
+  for( uint64_t i = 1; i < 1000; i += 2 )
+  {
+    ALWAYS_ASSERT( shard_integer_set_concurrent_erase( &our_set, i ) );
+    ALWAYS_ASSERT( !shard_integer_set_concurrent_erase( &our_set, i ) );
+  }
 
-    UNTIL_SUCCESS( vt_init_clone( &our_set_clones[ i ], &our_sets[ i ], our_sets[ i ].ctx ) );
-    ALWAYS_ASSERT( our_set_clones[ i ].ctx.id == i );
+  ALWAYS_ASSERT( shard_integer_set_concurrent_size( &our_set ) == 500 );
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( shard_integer_set_concurrent_get( &our_set, i ) == ( i % 2 == 0 ) );
 
-    for( size_t j = 50; j < 100; ++j )
-      UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set_clones[ i ], j ) ) );
+  // Lock and unlock.
+  shard_integer_set *shard = shard_integer_set_concurrent_lock( &our_set, 1000 );
+  ALWAYS_ASSERT( shard == &our_set.shards[ ( ( vt_hash_integer( 1000 ) >> 32 ) & 0xFFFFF ) % 4 ].table );
+  UNTIL_SUCCESS( !vt_is_end( vt_get_or_insert( shard, 1000 ) ) );
+  shard_integer_set_concurrent_unlock( &our_set, shard );
 
-    vt_cleanup( &our_sets[ i ] );
-    vt_cleanup( &our_set_clones[ i ] );
+  ALWAYS_ASSERT( shard_integer_set_concurrent_get( &our_set, 1000 ) );
+  ALWAYS_ASSERT( shard_integer_set_concurrent_size( &our_set ) == 501 );
+
+  // Clear.
+  shard_integer_set_concurrent_clear( &our_set );
+  ALWAYS_ASSERT( shard_integer_set_concurrent_size( &our_set ) == 0 );
+  ALWAYS_ASSERT( !shard_integer_set_concurrent_get( &our_set, 0 ) );
+
+  UNTIL_SUCCESS( shard_integer_set_concurrent_insert( &our_set, 0 ) );
+  ALWAYS_ASSERT( shard_integer_set_concurrent_size( &our_set ) == 1 );
+
+  shard_integer_set_concurrent_cleanup( &our_set );
+}
+
+void test_set_seqlock( void )
+{
+  integer_set_seqlock our_set;
+  vt_init( &our_set );
+
+  ALWAYS_ASSERT( !integer_set_seqlock_get_concurrent( &our_set, 0 ) );
+
+  // Insert keys, checking that each modification leaves the sequence counter even and advanced.
+  for( uint64_t i = 0; i < 1000; ++i )
+  {
+    size_t seq = our_set.seq;
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+    ALWAYS_ASSERT( our_set.seq % 2 == 0 && our_set.seq > seq );
+  }
+
+  // Growing the table retired the replaced buckets arrays rather than freeing them.
+  ALWAYS_ASSERT( our_set.retired );
+
+  // Get.
+  for( uint64_t i = 0; i < 2000; ++i )
+  {
+    size_t seq = our_set.seq;
+    ALWAYS_ASSERT( integer_set_seqlock_get_concurrent( &our_set, i ) == ( i < 1000 ) );
+    ALWAYS_ASSERT( our_set.seq == seq );
+  }
+
+  // Replace.
+  for( uint64_t i = 0; i < 1000; i += 2 )
+  {
+    size_t seq = our_set.seq;
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+    ALWAYS_ASSERT( our_set.seq % 2 == 0 && our_set.seq > seq );
+  }
+
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( integer_set_seqlock_get_concurrent( &our_set, i ) );
+
+  // Erase.
+  for( uint64_t i = 1; i < 1000; i += 2 )
+  {
+    size_t seq = our_set.seq;
+    ALWAYS_ASSERT( vt_erase( &our_set, i ) );
+    ALWAYS_ASSERT( our_set.seq % 2 == 0 && our_set.seq > seq );
+  }
+
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( integer_set_seqlock_get_concurrent( &our_set, i ) == ( i % 2 == 0 ) );
+
+  // Reclaim.
+  integer_set_seqlock_reclaim( &our_set );
+  ALWAYS_ASSERT( !our_set.retired );
+
+  // Shrink, which retires the buckets array again.
+  UNTIL_SUCCESS( vt_shrink( &our_set ) );
+  ALWAYS_ASSERT( our_set.retired && our_set.seq % 2 == 0 );
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( integer_set_seqlock_get_concurrent( &our_set, i ) == ( i % 2 == 0 ) );
+
+  // Clear.
+  size_t seq = our_set.seq;
+  vt_clear( &our_set );
+  ALWAYS_ASSERT( our_set.seq % 2 == 0 && our_set.seq > seq );
+  ALWAYS_ASSERT( !integer_set_seqlock_get_concurrent( &our_set, 0 ) );
+
+  // Shrink to zero buckets, leaving a retired buckets array for NAME_cleanup to free.
+  UNTIL_SUCCESS( vt_shrink( &our_set ) );
+  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == 0 && our_set.retired );
+  ALWAYS_ASSERT( !integer_set_seqlock_get_concurrent( &our_set, 0 ) );
+
+  vt_cleanup( &our_set );
+  ALWAYS_ASSERT( !our_set.retired );
+}
+
+void test_set_reserve_parallel( void )
+{
+  parallel_integer_set our_set;
+  vt_init( &our_set );
+
+  // Reserve up from placeholder, which rehashes in the calling thread.
+  UNTIL_SUCCESS( parallel_integer_set_reserve_parallel( &our_set, 30, 4 ) );
+  ALWAYS_ASSERT( 30 <= vt_bucket_count( &our_set ) * GLOBAL_MAX_LOAD );
+
+  for( uint64_t i = 0; i < 2000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  // Reserve up with various thread counts, including more threads than the bucket count permits.
+  size_t sizes[] = { 4000, 8000, 16000, 32000 };
+  unsigned int thread_counts[] = { 2, 3, 8, 1000 };
+  for( int j = 0; j < 4; ++j )
+  {
+    UNTIL_SUCCESS( parallel_integer_set_reserve_parallel( &our_set, sizes[ j ], thread_counts[ j ] ) );
+    ALWAYS_ASSERT( sizes[ j ] <= vt_bucket_count( &our_set ) * GLOBAL_MAX_LOAD );
+    ALWAYS_ASSERT( vt_size( &our_set ) == 2000 );
+    for( uint64_t i = 0; i < 2000; ++i )
+    {
+      parallel_integer_set_itr itr = vt_get( &our_set, i );
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    }
+  }
+
+  // Reserve lower capacity.
+  size_t bucket_count = vt_bucket_count( &our_set );
+  UNTIL_SUCCESS( parallel_integer_set_reserve_parallel( &our_set, 4000, 4 ) );
+  ALWAYS_ASSERT( vt_bucket_count( &our_set ) == bucket_count );
+
+  // Test validity through use.
+  for( uint64_t i = 0; i < 2000; i += 2 )
+    ALWAYS_ASSERT( vt_erase( &our_set, i ) );
+
+  for( uint64_t i = 2000; i < 4000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 3000 );
+  for( uint64_t i = 0; i < 4000; ++i )
+  {
+    parallel_integer_set_itr itr = vt_get( &our_set, i );
+    if( i < 2000 && i % 2 == 0 )
+      ALWAYS_ASSERT( vt_is_end( itr ) );
+    else
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+  }
+
+  // Reserve up from an empty table with buckets.
+  vt_clear( &our_set );
+  UNTIL_SUCCESS( parallel_integer_set_reserve_parallel( &our_set, 64000, 4 ) );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 0 && 64000 <= vt_bucket_count( &our_set ) * GLOBAL_MAX_LOAD );
+
+  vt_cleanup( &our_set );
+
+  // Keys whose hash codes share their low 16 bits share a home bucket, so a thread whose bucket range covers only a
+  // small fraction of the buckets cannot place many of them and defers the rest to the calling thread.
+  // With enough such keys, the threads' deferred arrays fill up, and the function falls back on a serial rehash.
+  parallel_integer_set_with_identity_hash identity_set;
+  vt_init( &identity_set );
+  UNTIL_SUCCESS( vt_reserve( &identity_set, 4000 ) );
+
+  uint64_t key_counts[] = { 160, 400 };
+  for( int j = 0; j < 2; ++j )
+  {
+    for( uint64_t i = j ? key_counts[ j - 1 ] : 0; i < key_counts[ j ]; ++i )
+      UNTIL_SUCCESS( !vt_is_end( vt_insert( &identity_set, i << 16 ) ) );
+
+    size_t size = vt_bucket_count( &identity_set ) * 2 * GLOBAL_MAX_LOAD;
+    UNTIL_SUCCESS( parallel_integer_set_with_identity_hash_reserve_parallel( &identity_set, size, 16 ) );
+    ALWAYS_ASSERT( vt_size( &identity_set ) == key_counts[ j ] );
+    for( uint64_t i = 0; i < key_counts[ j ]; ++i )
+    {
+      parallel_integer_set_with_identity_hash_itr itr = vt_get( &identity_set, i << 16 );
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i << 16 );
+    }
+  }
+
+  vt_cleanup( &identity_set );
+}
+
+void test_set_build_parallel( void )
+{
+  parallel_integer_set our_set;
+  vt_init( &our_set );
+
+  uint64_t keys[ 5000 ];
+  for( uint64_t i = 0; i < 5000; ++i )
+  {
+    keys[ i ] = i;
+  }
+
+  // Build nothing.
+  UNTIL_SUCCESS( parallel_integer_set_build_parallel( &our_set, keys, 0, 4 ) );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 0 );
+
+  // Build an empty table.
+  UNTIL_SUCCESS( parallel_integer_set_build_parallel( &our_set, keys, 4000, 8 ) );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 4000 );
+  ALWAYS_ASSERT( 4000 <= vt_bucket_count( &our_set ) * GLOBAL_MAX_LOAD );
+  for( uint64_t i = 0; i < 5000; ++i )
+  {
+    parallel_integer_set_itr itr = vt_get( &our_set, i );
+    if( i < 4000 )
+      ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+    else
+      ALWAYS_ASSERT( vt_is_end( itr ) );
+  }
+
+  // Build a non-empty table, which inserts the keys in the calling thread.
+  UNTIL_SUCCESS( parallel_integer_set_build_parallel( &our_set, keys + 3000, 2000, 8 ) );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 5000 );
+  for( uint64_t i = 0; i < 5000; ++i )
+  {
+    parallel_integer_set_itr itr = vt_get( &our_set, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+  }
+
+  // Build an empty table from keys containing duplicates, one of each of which is retained.
+  vt_clear( &our_set );
+  for( uint64_t i = 0; i < 5000; ++i )
+  {
+    keys[ i ] = i % 3000;
+  }
+
+  UNTIL_SUCCESS( parallel_integer_set_build_parallel( &our_set, keys, 5000, 8 ) );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 3000 );
+  for( uint64_t i = 0; i < 3000; ++i )
+  {
+    parallel_integer_set_itr itr = vt_get( &our_set, i );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i );
+  }
+
+  vt_cleanup( &our_set );
+
+  // Keys that share a home bucket are deferred to the calling thread (see test_set_reserve_parallel).
+  parallel_integer_set_with_identity_hash identity_set;
+  vt_init( &identity_set );
+
+  for( uint64_t i = 0; i < 400; ++i )
+  {
+    keys[ i ] = i << 16;
+  }
+
+  UNTIL_SUCCESS( parallel_integer_set_with_identity_hash_build_parallel( &identity_set, keys, 400, 16 ) );
+  ALWAYS_ASSERT( vt_size( &identity_set ) == 400 );
+  for( uint64_t i = 0; i < 400; ++i )
+  {
+    parallel_integer_set_with_identity_hash_itr itr = vt_get( &identity_set, i << 16 );
+    ALWAYS_ASSERT( !vt_is_end( itr ) && itr.data->key == i << 16 );
   }
+
+  vt_cleanup( &identity_set );
+}
+
+void test_set_save_load( void )
+{
+  const char *path = "vt_unit_test_set.bin";
+  FILE *file;
+
+  serialized_integer_set our_set;
+  vt_init( &our_set );
+
+  for( uint64_t i = 0; i < 1000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  // Test save and load.
+  file = fopen( path, "wb" );
+  ALWAYS_ASSERT( file );
+  ALWAYS_ASSERT( serialized_integer_set_save( &our_set, file ) );
+  fclose( file );
+
+  serialized_integer_set loaded;
+  ALWAYS_ASSERT( serialized_integer_set_load_mmap( &loaded, path ) );
+  ALWAYS_ASSERT( vt_size( &loaded ) == 1000 && vt_bucket_count( &loaded ) == vt_bucket_count( &our_set ) );
+  for( uint64_t i = 0; i < 1000; ++i )
+    ALWAYS_ASSERT( !vt_is_end( vt_get( &loaded, i ) ) );
+
+  // Test modifying and growing the loaded table.
+  for( uint64_t i = 0; i < 500; ++i )
+    ALWAYS_ASSERT( vt_erase( &loaded, i ) );
+
+  for( uint64_t i = 1000; i < 3000; ++i )
+    UNTIL_SUCCESS( !vt_is_end( vt_insert( &loaded, i ) ) );
+
+  ALWAYS_ASSERT( vt_size( &loaded ) == 2500 );
+  for( uint64_t i = 0; i < 3000; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &loaded, i ) ) == ( i < 500 ) );
+
+  vt_cleanup( &loaded );
+
+  // Test cleanup of a table whose buckets array is still mapped.
+  ALWAYS_ASSERT( serialized_integer_set_load_mmap( &loaded, path ) );
+  vt_cleanup( &loaded );
+
+  // Test incompatible file (a different HASH_FN_ID).
+  serialized_integer_set_with_hash_fn_id other_set;
+  ALWAYS_ASSERT( !serialized_integer_set_with_hash_fn_id_load_mmap( &other_set, path ) );
+  ALWAYS_ASSERT( vt_size( &other_set ) == 0 && vt_bucket_count( &other_set ) == 0 );
+  vt_cleanup( &other_set );
+
+  remove( path );
+  vt_cleanup( &our_set );
+}
+
+void test_set_huge_pages( void )
+{
+  vt_huge_page_ctx ctx = { 4096 };
+
+  huge_page_integer_set our_set;
+  vt_init( &our_set, ctx );
+
+  for( uint64_t i = 0; i < 10000; ++i )
+    ALWAYS_ASSERT( !vt_is_end( vt_insert( &our_set, i ) ) );
+
+  ALWAYS_ASSERT( vt_size( &our_set ) == 10000 );
+  for( uint64_t i = 0; i < 10000; ++i )
+    ALWAYS_ASSERT( !vt_is_end( vt_get( &our_set, i ) ) );
+
+  for( uint64_t i = 0; i < 10000; ++i )
+    if( i >= 100 )
+      ALWAYS_ASSERT( vt_erase( &our_set, i ) );
+
+  ALWAYS_ASSERT( vt_shrink( &our_set ) );
+  ALWAYS_ASSERT( vt_size( &our_set ) == 100 );
+  for( uint64_t i = 0; i < 10000; ++i )
+    ALWAYS_ASSERT( vt_is_end( vt_get( &our_set, i ) ) == ( i >= 100 ) );
+
+  vt_cleanup( &our_set );
 }
 
+// The implementation of the HEADER_MODE table above.
+
+#define NAME      header_mode_integer_map
+#define KEY_TY    uint64_t
+#define VAL_TY    uint64_t
+#define SERIALIZATION
+#define MAX_LOAD  GLOBAL_MAX_LOAD
+#define MALLOC_FN unreliable_tracking_malloc
+#define FREE_FN   tracking_free
+#define IMPLEMENTATION_MODE
+#include "../verstable.h"
+
 int main( void )
 {
   srand( (unsigned int)time( NULL ) );
@@ -1255,37 +4964,85 @@ int main( void )
   {
     // init, bucket_count, and size tested implicitly.
 
+    test_hash_bytes();
+
     // Map.
     test_map_reserve();
     test_map_shrink();
     test_map_insert();
     test_map_get_or_insert();
+    test_map_emplace();
+    test_map_get_or_insert_lazy();
     test_map_get();
+    test_map_get_batch();
+    test_map_with_hash();
     test_map_erase();
+    test_map_insert_n();
+    test_map_erase_n();
     test_map_erase_itr();
+    test_map_erase_if();
     test_map_clear();
     test_map_cleanup();
     test_map_init_clone();
+    test_map_set_operations();
     test_map_iteration();
+    test_map_sparse_iteration();
     test_map_dtors();
     test_map_strings();
+    test_map_lookup_key();
+    test_map_sso_strings();
     test_map_with_ctx();
+    test_map_with_stored_hash();
+    test_map_separate_values();
+    test_map_metadata_32();
+    test_map_ordered();
+    test_map_incremental_rehash();
+    test_map_stats();
+    test_map_freeze();
+    test_map_concurrent();
+    test_map_seqlock();
+    test_map_reserve_parallel();
+    test_map_build_parallel();
+    test_map_save_load();
+    test_map_huge_pages();
 
     // Set.
     test_set_reserve();
     test_set_shrink();
     test_set_insert();
     test_set_get_or_insert();
+    test_set_emplace();
+    test_set_get_or_insert_lazy();
     test_set_get();
+    test_set_get_batch();
+    test_set_with_hash();
     test_set_erase();
+    test_set_insert_n();
+    test_set_erase_n();
     test_set_erase_itr();
+    test_set_erase_if();
     test_set_clear();
     test_set_cleanup();
     test_set_init_clone();
+    test_set_set_operations();
     test_set_iteration();
     test_set_dtors();
     test_set_strings();
+    test_set_lookup_key();
+    test_set_sso_strings();
     test_set_with_ctx();
+    test_set_with_stored_hash();
+    test_set_metadata_32();
+    test_set_ordered();
+    test_set_incremental_rehash();
+    test_set_stats();
+    test_set_freeze();
+    test_set_concurrent();
+    test_set_seqlock();
+    test_set_reserve_parallel();
+    test_set_build_parallel();
+    test_set_save_load();
+    test_set_huge_pages();
   }
 
   ALWAYS_ASSERT( oustanding_allocs == 0 );